@@ -0,0 +1,384 @@
+// This is an independent project of an individual developer. Dear PVS-Studio,
+// please check it.
+
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java:
+// http://www.viva64.com
+#ifndef MY_DELIM_AGGREGATE_HPP
+#define MY_DELIM_AGGREGATE_HPP
+
+// Group-by over DelimitedTextReader columns: count, sum, min, max and
+// distinct of a value column, per distinct value of a key column.
+//
+//  using namespace my::aggregate;
+//  rd.materialise("dur", my::DelimitedTextReader::column_type::duration);
+//  auto per_artist = group_by_hash(*rd.column("artist"), rd.column("dur"));
+//
+// Rows are split into ranges, one per thread; each thread aggregates its
+// own range and the partial results are merged at the end. With a
+// dictionary-encoded key there is no hashing at all: groups are indexed by
+// code. sum/min/max need a materialised numeric or duration value column.
+
+#include "my_delim_query.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace my {
+namespace aggregate {
+
+    using column_t = query::column_t;
+    using value_type = query::value_type;
+
+    struct stats {
+        size_t count = 0;
+        double sum = 0;
+        double min = (std::numeric_limits<double>::max)();
+        double max = std::numeric_limits<double>::lowest();
+
+        void add(double v) noexcept {
+            sum += v;
+            min = (std::min)(min, v);
+            max = (std::max)(max, v);
+        }
+        void merge(const stats& rhs) noexcept {
+            count += rhs.count;
+            sum += rhs.sum;
+            min = (std::min)(min, rhs.min);
+            max = (std::max)(max, rhs.max);
+        }
+        double mean() const noexcept {
+            return count != 0 ? sum / static_cast<double>(count) : 0.0;
+        }
+    };
+
+    struct group {
+        std::string_view key;
+        stats values; // count is always set; the rest only for numeric values
+        size_t distinct = 0; // only if options::count_distinct
+    };
+
+    struct options {
+        size_t threads = 0; // 0: one per hardware thread
+        size_t min_rows_per_thread = 64 * 1024;
+        const query::selection* where = nullptr; // only these rows, if set
+        // for text (non-dictionary) keys, and for count_distinct
+        bool case_insensitive = true;
+        bool count_distinct = false; // distinct values of the value column
+    };
+
+    namespace detail {
+        // hash and equality for distinct values, with or without case
+        struct value_hash {
+            bool ci = true;
+            size_t operator()(std::string_view s) const noexcept {
+                return ci ? column_name_hash()(s)
+                          : std::hash<std::string_view>()(s);
+            }
+        };
+        struct value_equal {
+            bool ci = true;
+            bool operator()(
+                std::string_view a, std::string_view b) const noexcept {
+                return ci ? column_name_equal()(a, b) : a == b;
+            }
+        };
+
+        struct partial {
+            stats s;
+            std::unordered_set<std::string_view, value_hash, value_equal> seen;
+
+            explicit partial(bool ci)
+                : seen(0, value_hash{ci}, value_equal{ci}) {}
+
+            void merge(partial& rhs) {
+                s.merge(rhs.s);
+                if (seen.empty()) {
+                    seen.swap(rhs.seen);
+                } else {
+                    seen.insert(rhs.seen.begin(), rhs.seen.end());
+                }
+            }
+        };
+
+        // reads a row of the value column
+        struct value_reader {
+            const column_t* col = nullptr;
+            bool numeric = false;
+            bool distinct = false;
+
+            value_reader(const column_t* c, bool count_distinct)
+                : col(c), distinct(count_distinct && c != nullptr) {
+                if (col != nullptr) {
+                    const auto t = col->typed.type;
+                    numeric = t == value_type::int64 || t == value_type::real
+                        || t == value_type::duration;
+                }
+            }
+
+            double number(size_t row) const noexcept {
+                const auto& t = col->typed;
+                switch (t.type) {
+                    case value_type::int64:
+                        return static_cast<double>(t.ints[row]);
+                    case value_type::real: return t.reals[row];
+                    case value_type::duration:
+                        return static_cast<double>(t.secs[row]);
+                    default: return 0;
+                }
+            }
+
+            // distinct values go by the text, not by any dictionary code, so
+            // that options::case_insensitive decides what counts as distinct
+            void add(partial& p, size_t row) const {
+                ++p.s.count;
+                if (numeric) p.s.add(number(row));
+                if (distinct) p.seen.insert(col->values[row]);
+            }
+        };
+
+        inline size_t thread_count(size_t rows, const options& opt) {
+            const size_t hw = opt.threads != 0
+                ? opt.threads
+                : (std::max)(1U, std::thread::hardware_concurrency());
+            const size_t by_size
+                = rows / (std::max)(size_t{1}, opt.min_rows_per_thread);
+            return (std::max)(size_t{1}, (std::min)(hw, by_size));
+        }
+
+        // fn(thread_index, first_row, end_row), on nthreads threads (the
+        // first of them being the caller's). If fn throws, every thread is
+        // still joined, and then the first exception (by thread index) is
+        // rethrown here.
+        template <typename FN>
+        void for_each_range(size_t rows, size_t nthreads, FN&& fn) {
+            const size_t per = (rows + nthreads - 1) / nthreads;
+            std::vector<std::exception_ptr> errors(nthreads);
+            std::vector<std::thread> threads;
+            threads.reserve(nthreads);
+            for (size_t t = 1; t < nthreads; ++t) {
+                const size_t b = (std::min)(rows, t * per);
+                const size_t e = (std::min)(rows, b + per);
+                try {
+                    threads.emplace_back([&fn, &errors, t, b, e] {
+                        try {
+                            fn(t, b, e);
+                        } catch (...) {
+                            errors[t] = std::current_exception();
+                        }
+                    });
+                } catch (...) { // could not start the thread
+                    errors[t] = std::current_exception();
+                }
+            }
+            try {
+                fn(size_t{0}, size_t{0}, (std::min)(rows, per));
+            } catch (...) {
+                errors[0] = std::current_exception();
+            }
+            for (auto& th : threads) {
+                th.join();
+            }
+            for (auto& err : errors) {
+                if (err) std::rethrow_exception(err);
+            }
+        }
+
+        inline bool wanted(const options& opt, size_t row) noexcept {
+            return opt.where == nullptr || opt.where->test(row);
+        }
+
+        inline group to_group(std::string_view key, partial& p) {
+            return group{key, p.s, p.seen.size()};
+        }
+
+        inline bool key_less(
+            std::string_view a, std::string_view b, bool ci) noexcept {
+            return ci ? utils::strings::compare_less_nocase(a, b) : a < b;
+        }
+        inline bool key_equal(
+            std::string_view a, std::string_view b, bool ci) noexcept {
+            return ci ? column_name_equal()(a, b) : a == b;
+        }
+    } // namespace detail
+
+    // Hash-based group-by. With a dictionary-encoded key the groups come
+    // back in code order; otherwise in no particular order. value may be
+    // nullptr if you only want counts.
+    inline std::vector<group> group_by_hash(const column_t& key,
+        const column_t* value = nullptr, const options& opt = {}) {
+
+        const auto rows = key.values.size();
+        assert(value == nullptr || value->values.size() == rows);
+        assert(opt.where == nullptr || opt.where->size() == rows);
+        const detail::value_reader vr(value, opt.count_distinct);
+        const auto nthreads = detail::thread_count(rows, opt);
+        std::vector<group> ret;
+
+        if (key.typed.type == value_type::dictionary) {
+            const auto& dict = key.typed.dict;
+            std::vector<std::vector<detail::partial>> parts(nthreads,
+                std::vector<detail::partial>(
+                    dict.distinct(), detail::partial(opt.case_insensitive)));
+            detail::for_each_range(
+                rows, nthreads, [&](size_t t, size_t b, size_t e) {
+                    auto& mine = parts[t];
+                    for (size_t r = b; r < e; ++r) {
+                        if (detail::wanted(opt, r)) {
+                            vr.add(mine[dict.codes[r]], r);
+                        }
+                    }
+                });
+            for (size_t t = 1; t < nthreads; ++t) {
+                for (size_t c = 0; c < dict.distinct(); ++c) {
+                    parts[0][c].merge(parts[t][c]);
+                }
+            }
+            for (size_t c = 0; c < dict.distinct(); ++c) {
+                if (parts[0][c].s.count != 0) {
+                    ret.push_back(
+                        detail::to_group(dict.dictionary[c], parts[0][c]));
+                }
+            }
+            return ret;
+        }
+
+        const auto entry = [&](auto& map, std::string_view k) -> auto& {
+            return map.try_emplace(k, opt.case_insensitive).first->second;
+        };
+        const auto run = [&](auto map_type_tag) {
+            using map_type = decltype(map_type_tag);
+            std::vector<map_type> parts(nthreads);
+            detail::for_each_range(
+                rows, nthreads, [&](size_t t, size_t b, size_t e) {
+                    auto& mine = parts[t];
+                    for (size_t r = b; r < e; ++r) {
+                        if (detail::wanted(opt, r)) {
+                            vr.add(entry(mine, key.values[r]), r);
+                        }
+                    }
+                });
+            for (size_t t = 1; t < nthreads; ++t) {
+                for (auto& kv : parts[t]) {
+                    entry(parts[0], kv.first).merge(kv.second);
+                }
+            }
+            ret.reserve(parts[0].size());
+            for (auto& kv : parts[0]) {
+                ret.push_back(detail::to_group(kv.first, kv.second));
+            }
+        };
+        if (opt.case_insensitive) {
+            run(std::unordered_map<std::string_view, detail::partial,
+                column_name_hash, column_name_equal>{});
+        } else {
+            run(std::unordered_map<std::string_view, detail::partial>{});
+        }
+        return ret;
+    }
+
+    // Sort-based group-by: each thread sorts its rows by key and folds the
+    // runs, then the sorted partial results are merged. Uses less memory
+    // than group_by_hash() when nearly every key is different. The groups
+    // come back sorted by key (by code, for a dictionary-encoded key).
+    inline std::vector<group> group_by_sort(const column_t& key,
+        const column_t* value = nullptr, const options& opt = {}) {
+
+        const auto rows = key.values.size();
+        assert(value == nullptr || value->values.size() == rows);
+        assert(opt.where == nullptr || opt.where->size() == rows);
+        const detail::value_reader vr(value, opt.count_distinct);
+        const auto nthreads = detail::thread_count(rows, opt);
+        const bool dict = key.typed.type == value_type::dictionary;
+        const bool ci = opt.case_insensitive;
+
+        const auto less = [&](size_t a, size_t b) {
+            if (dict) return key.typed.dict.codes[a] < key.typed.dict.codes[b];
+            return detail::key_less(key.values[a], key.values[b], ci);
+        };
+        const auto same = [&](size_t a, size_t b) {
+            if (dict) return key.typed.dict.codes[a] == key.typed.dict.codes[b];
+            return detail::key_equal(key.values[a], key.values[b], ci);
+        };
+        const auto key_of = [&](size_t row) {
+            return dict ? key.typed.dict.value(row) : key.values[row];
+        };
+
+        // per thread: (first row of the group, partial), sorted by key
+        using run_list = std::vector<std::pair<size_t, detail::partial>>;
+        std::vector<run_list> parts(nthreads);
+        detail::for_each_range(rows, nthreads, [&](size_t t, size_t b, size_t e) {
+            std::vector<size_t> idx;
+            idx.reserve(e - b);
+            for (size_t r = b; r < e; ++r) {
+                if (detail::wanted(opt, r)) idx.push_back(r);
+            }
+            std::sort(idx.begin(), idx.end(), less);
+            auto& mine = parts[t];
+            for (size_t i = 0; i < idx.size(); ++i) {
+                if (i == 0 || !same(idx[i - 1], idx[i])) {
+                    mine.emplace_back(idx[i], detail::partial(ci));
+                }
+                vr.add(mine.back().second, idx[i]);
+            }
+        });
+
+        // pairwise merge of the sorted run lists
+        run_list merged = std::move(parts[0]);
+        for (size_t t = 1; t < nthreads; ++t) {
+            run_list next;
+            next.reserve(merged.size() + parts[t].size());
+            size_t i = 0;
+            size_t j = 0;
+            auto& other = parts[t];
+            while (i < merged.size() || j < other.size()) {
+                if (j == other.size()
+                    || (i < merged.size()
+                        && less(merged[i].first, other[j].first))) {
+                    next.push_back(std::move(merged[i++]));
+                } else if (i == merged.size()
+                    || less(other[j].first, merged[i].first)) {
+                    next.push_back(std::move(other[j++]));
+                } else {
+                    merged[i].second.merge(other[j++].second);
+                    next.push_back(std::move(merged[i++]));
+                }
+            }
+            merged.swap(next);
+        }
+
+        std::vector<group> ret;
+        ret.reserve(merged.size());
+        for (auto& run : merged) {
+            ret.push_back(detail::to_group(key_of(run.first), run.second));
+        }
+        return ret;
+    }
+
+    // Aggregate of the value column over all (selected) rows.
+    inline group totals(const column_t& value, const options& opt = {}) {
+        const auto rows = value.values.size();
+        const detail::value_reader vr(&value, opt.count_distinct);
+        const auto nthreads = detail::thread_count(rows, opt);
+        std::vector<detail::partial> parts(
+            nthreads, detail::partial(opt.case_insensitive));
+        detail::for_each_range(rows, nthreads, [&](size_t t, size_t b, size_t e) {
+            for (size_t r = b; r < e; ++r) {
+                if (detail::wanted(opt, r)) vr.add(parts[t], r);
+            }
+        });
+        for (size_t t = 1; t < nthreads; ++t) {
+            parts[0].merge(parts[t]);
+        }
+        return detail::to_group({}, parts[0]);
+    }
+
+} // namespace aggregate
+} // namespace my
+
+#endif // MY_DELIM_AGGREGATE_HPP
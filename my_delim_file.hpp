@@ -7,10 +7,12 @@
 #define DELIM_FILE_HPP
 
 #include "my_utils.hpp"
+#include "my_memory_utils.hpp"
 #include <unordered_map>
 #include <string_view>
 #include <cstdint>
 #include <unordered_set>
+#include <deque>
 
 namespace my {
 
@@ -27,37 +29,559 @@ string_map_type make_unique_values(const std::vector<std::string_view>& v) {
     return retval;
 }
 
+// Case-insensitive (ASCII) hashing and comparison of column names that
+// folds case as it goes, rather than upper-casing a copy, so looking a
+// column up by name never allocates.
+struct column_name_hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view sv) const noexcept {
+        return utils::strings::ci_hash(sv);
+    }
+};
+
+struct column_name_equal {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const noexcept {
+        return utils::strings::ci_equal(a, b);
+    }
+};
+
+// A column with lots of repetition, held as one copy of each distinct value
+// plus a compact code per row, so that equality, grouping and distinct
+// counts become integer operations. dictionary[codes[row]] is the value.
+struct dictionary_encoded {
+    using code_type = uint32_t;
+    static constexpr code_type invalid_code = static_cast<code_type>(-1);
+
+    std::vector<std::string_view> dictionary;
+    std::vector<code_type> codes;
+    bool case_insensitive = true;
+
+    size_t size() const noexcept { return codes.size(); }
+    size_t distinct() const noexcept { return dictionary.size(); }
+    std::string_view value(size_t row) const noexcept {
+        return dictionary[codes[row]];
+    }
+
+    // linear in distinct(): look the code up once, then compare codes.
+    code_type find_code(std::string_view what) const noexcept {
+        for (size_t i = 0; i < dictionary.size(); ++i) {
+            const bool eq = case_insensitive
+                ? utils::strings::ci_equal_to<>()(dictionary[i], what)
+                : dictionary[i] == what;
+            if (eq) return static_cast<code_type>(i);
+        }
+        return invalid_code;
+    }
+
+    // how many rows hold each code, indexed by code
+    std::vector<size_t> counts() const {
+        std::vector<size_t> ret(dictionary.size());
+        for (const auto c : codes) {
+            ++ret[c];
+        }
+        return ret;
+    }
+};
+
+namespace detail {
+    // encodes v[from..], adding to out
+    template <typename MAP>
+    void dictionary_encode(MAP& lookup, const std::vector<std::string_view>& v,
+        dictionary_encoded& out, size_t from = 0) {
+        out.codes.resize(v.size());
+        for (size_t i = from; i < v.size(); ++i) {
+            const auto code
+                = static_cast<dictionary_encoded::code_type>(
+                    out.dictionary.size());
+            const auto ins = lookup.try_emplace(v[i], code);
+            if (ins.second) out.dictionary.push_back(v[i]);
+            out.codes[i] = ins.first->second;
+        }
+    }
+} // namespace detail
+
+// Codes are assigned in order of first appearance. When case_insensitive,
+// the first spelling seen is the one kept in the dictionary (as with
+// make_unique_values).
+static inline dictionary_encoded make_dictionary(
+    const std::vector<std::string_view>& v, bool case_insensitive = true) {
+
+    dictionary_encoded ret{};
+    ret.case_insensitive = case_insensitive;
+    if (case_insensitive) {
+        my::utils::strings::case_insensitive_unordered_map<std::string_view,
+            dictionary_encoded::code_type>
+            lookup;
+        detail::dictionary_encode(lookup, v, ret);
+    } else {
+        std::unordered_map<std::string_view, dictionary_encoded::code_type>
+            lookup;
+        detail::dictionary_encode(lookup, v, ret);
+    }
+    return ret;
+}
+
+// Encodes v[from..] into an existing dictionary (made from the earlier
+// values of v), keeping the codes already assigned.
+static inline void extend_dictionary(dictionary_encoded& dict,
+    const std::vector<std::string_view>& v, size_t from) {
+
+    assert(from == dict.codes.size());
+    const auto fill = [&](auto& lookup) {
+        for (size_t i = 0; i < dict.dictionary.size(); ++i) {
+            lookup.try_emplace(dict.dictionary[i],
+                static_cast<dictionary_encoded::code_type>(i));
+        }
+        detail::dictionary_encode(lookup, v, dict, from);
+    };
+    if (dict.case_insensitive) {
+        my::utils::strings::case_insensitive_unordered_map<std::string_view,
+            dictionary_encoded::code_type>
+            lookup;
+        fill(lookup);
+    } else {
+        std::unordered_map<std::string_view, dictionary_encoded::code_type>
+            lookup;
+        fill(lookup);
+    }
+}
+
+namespace detail {
+    // Sequential, bounds-checked binary I/O for the reader's cache files.
+    // Everything goes through memcpy, so nothing needs to be aligned.
+    struct cache_writer {
+        std::ostream& os;
+        void put_bytes(const void* p, size_t n) {
+            os.write(static_cast<const char*>(p), static_cast<std::streamsize>(n));
+        }
+        template <typename T> void put(const T& v) { put_bytes(&v, sizeof(v)); }
+        template <typename T> void put_array(const std::vector<T>& v) {
+            put(static_cast<uint64_t>(v.size()));
+            put_bytes(v.data(), v.size() * sizeof(T));
+        }
+        void put_string(std::string_view s) {
+            put(static_cast<uint64_t>(s.size()));
+            put_bytes(s.data(), s.size());
+        }
+    };
+
+    struct cache_reader {
+        const char* p;
+        const char* end;
+        size_t remaining() const noexcept { return static_cast<size_t>(end - p); }
+        bool get_bytes(void* dest, size_t n) noexcept {
+            if (remaining() < n) return false;
+            if (n > 0) memcpy(dest, p, n);
+            p += n;
+            return true;
+        }
+        template <typename T> bool get(T& v) noexcept {
+            return get_bytes(&v, sizeof(v));
+        }
+        template <typename T> bool get_array(std::vector<T>& v) {
+            uint64_t n = 0;
+            if (!get(n) || n > remaining() / sizeof(T)) return false;
+            v.resize(static_cast<size_t>(n));
+            return get_bytes(v.data(), v.size() * sizeof(T));
+        }
+        bool get_string(std::string& s) {
+            uint64_t n = 0;
+            if (!get(n) || n > remaining()) return false;
+            s.assign(p, static_cast<size_t>(n));
+            p += n;
+            return true;
+        }
+    };
+
+    // FNV-1a, a word at a time. It is persisted in cache files, so don't
+    // change it without bumping the cache version. Feeding the data in
+    // pieces gives the same result as hashing it all at once.
+    struct cache_hasher {
+        uint64_t h = 14695981039346656037ULL;
+        char tail[8] = {};
+        size_t tail_size = 0;
+
+        void word(const char* p) noexcept {
+            uint64_t w = 0;
+            memcpy(&w, p, 8);
+            h = (h ^ w) * 1099511628211ULL;
+            h ^= h >> 32;
+        }
+        cache_hasher& update(std::string_view data) noexcept {
+            size_t i = 0;
+            if (tail_size > 0) {
+                while (tail_size < 8 && i < data.size()) {
+                    tail[tail_size++] = data[i++];
+                }
+                if (tail_size < 8) return *this;
+                word(tail);
+                tail_size = 0;
+            }
+            for (; i + 8 <= data.size(); i += 8) {
+                word(data.data() + i);
+            }
+            for (; i < data.size(); ++i) {
+                tail[tail_size++] = data[i];
+            }
+            return *this;
+        }
+        uint64_t finish() const noexcept {
+            uint64_t ret = h;
+            for (size_t i = 0; i < tail_size; ++i) {
+                ret = (ret ^ static_cast<unsigned char>(tail[i]))
+                    * 1099511628211ULL;
+            }
+            return ret;
+        }
+    };
+
+    static inline uint64_t cache_hash(std::string_view data) noexcept {
+        return cache_hasher{}.update(data).finish();
+    }
+} // namespace detail
+
+// have seen some artist (Celine dion in my case) start with an ETX
+// character or something stupid
+static inline std::string_view sanitize_field(std::string_view what) noexcept {
+    static constexpr const char SPACE = ' ';
+    const char* ptr = what.data();
+
+    for (const char c : what) {
+        if (static_cast<int>(c) < static_cast<int>(SPACE)) {
+            ++ptr;
+        } else {
+            break; // just checking for leading bad chars
+        }
+    }
+    const char* end = what.data() + what.size();
+    return std::string_view(ptr, end - ptr);
+}
+
+// Splits line on delim (an exact sequence, not any-of) into fields, which
+// is cleared first.
+static inline void split_fields(std::string_view line, std::string_view delim,
+    std::vector<std::string_view>& fields, bool sanitize = true) {
+    assert(!delim.empty());
+    utils::strings::split_into(fields, line, delim);
+    if (sanitize) {
+        for (auto& f : fields) {
+            f = sanitize_field(f);
+        }
+    }
+}
+
+// Reads a delimited file a buffer at a time, handing each row to a callback
+// as a set of string_views. Nothing but the current buffer (plus any partial
+// line carried over from the previous read) is ever resident, so memory use
+// is constant whatever the size of the file.
+struct DelimitedStreamReader {
+    static constexpr size_t default_buffer_size = 1024 * 1024;
+
+    // Only valid for the duration of the callback: the views point into
+    // the read buffer, which is recycled for the next chunk of the file.
+    struct row_view {
+        size_t row = 0; // zero-based, not counting the header
+        size_t line_number = 0; // one-based, as you'd see it in an editor
+        std::string_view line;
+        std::vector<std::string_view> fields;
+
+        size_t size() const noexcept { return fields.size(); }
+        std::string_view operator[](size_t i) const noexcept {
+            return i < fields.size() ? fields[i] : std::string_view{};
+        }
+    };
+
+    DelimitedStreamReader(std::string_view filepath,
+        std::string_view delim = "\t", bool has_header = true,
+        size_t buffer_size = default_buffer_size)
+        : m_filepath(filepath)
+        , m_delim(delim)
+        , m_has_header(has_header)
+        , m_buffer_size(buffer_size ? buffer_size : default_buffer_size) {
+        assert(!m_delim.empty());
+    }
+
+    const std::vector<std::string>& column_names() const noexcept {
+        return m_column_names;
+    }
+    // returns -1 if not found
+    int column_index(std::string_view name) const noexcept {
+        for (size_t i = 0; i < m_column_names.size(); ++i) {
+            if (column_name_equal()(m_column_names[i], name)) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+    size_t rows_read() const noexcept { return m_row.row; }
+
+    // Calls cb(const row_view&) for every data row. If the callback returns
+    // a negative value, reading stops and that value is returned (same
+    // contract as my::listdir). Returns 0 when the whole file has been read.
+    // Throws std::system_error if the file cannot be opened.
+    template <typename Cb> int for_each_row(Cb&& cb) {
+        std::fstream f;
+        utils::file_open(
+            f, m_filepath, std::ios::in | std::ios::binary, true);
+
+        m_column_names.clear();
+        m_row = row_view{};
+        std::string buf(m_buffer_size, '\0');
+        size_t carry = 0;
+
+        while (true) {
+            if (carry == buf.size()) {
+                // a single line longer than the whole buffer
+                buf.resize(buf.size() * 2);
+            }
+            f.read(buf.data() + carry,
+                static_cast<std::streamsize>(buf.size() - carry));
+            const auto got = static_cast<size_t>(f.gcount());
+            const bool at_end = !f;
+            const std::string_view chunk(buf.data(), carry + got);
+
+            size_t pos = 0;
+            while (pos < chunk.size()) {
+                const void* nl = memchr(
+                    chunk.data() + pos, '\n', chunk.size() - pos);
+                if (nl == nullptr) break;
+                const auto end = static_cast<size_t>(
+                    static_cast<const char*>(nl) - chunk.data());
+                if (const int r = emit(chunk.substr(pos, end - pos), cb);
+                    r < 0) {
+                    return r;
+                }
+                pos = end + 1;
+            }
+
+            carry = chunk.size() - pos;
+            if (at_end) {
+                if (carry > 0) {
+                    // last line with no terminator
+                    if (const int r = emit(chunk.substr(pos), cb); r < 0) {
+                        return r;
+                    }
+                }
+                break;
+            }
+            if (carry > 0 && pos > 0) {
+                memmove(buf.data(), buf.data() + pos, carry);
+            }
+        }
+        return 0;
+    }
+
+    private:
+    std::string m_filepath;
+    std::string m_delim;
+    bool m_has_header{true};
+    size_t m_buffer_size{default_buffer_size};
+    std::vector<std::string> m_column_names;
+    row_view m_row;
+
+    template <typename Cb> int emit(std::string_view line, Cb& cb) {
+        ++m_row.line_number;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) return 0;
+
+        split_fields(line, m_delim, m_row.fields);
+        if (m_has_header && m_column_names.empty()) {
+            for (const auto& field : m_row.fields) {
+                m_column_names.emplace_back(field);
+            }
+            return 0;
+        }
+
+        m_row.line = line;
+        const int r = cb(static_cast<const row_view&>(m_row));
+        ++m_row.row;
+        return r;
+    }
+};
+
 struct DelimitedTextReader {
     using rows_type = std::vector<std::string_view>;
     using uid_type = uint32_t;
 
+    // How a column is held once materialised. text is the default: the
+    // values stay as string_views into the file data and nothing is parsed.
+    enum class column_type { text, int64, real, duration, dictionary };
+
+    // Contiguous, parsed-once copies of a column's values. Only the vector
+    // that matches type is populated. Empty fields become zero; fields that
+    // are not empty but fail to parse also become zero, and are counted.
+    struct typed_values {
+        column_type type{column_type::text};
+        std::vector<int64_t> ints;
+        std::vector<double> reals;
+        std::vector<int32_t> secs; // durations, in seconds
+        dictionary_encoded dict;
+        size_t parse_errors = 0;
+    };
+
     struct column {
         rows_type values;
         std::string name;
         size_t index;
+        typed_values typed;
     };
     using columns_type = std::vector<column>;
-    using column_keys_type = std::unordered_map<std::string, column*>;
+    // column name -> index into columns(), built once after parsing
+    using column_keys_type = std::unordered_map<std::string, size_t,
+        column_name_hash, column_name_equal>;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // 1:23, 01:02:03, 3:11.5, or a plain number of seconds
+    static bool looks_like_duration(std::string_view sv) noexcept {
+        double secs = 0;
+        return utils::strings::parse_duration(sv, secs);
+    }
+
+    // Guess a column's type from (up to) its first sample_rows non-empty
+    // values. Whole numbers win over reals, reals over durations. Text with
+    // few distinct values (no more than one in four) is a dictionary;
+    // distinct as make_dictionary() sees it, ignoring case.
+    static column_type infer_type(
+        const column& col, size_t sample_rows = 1024) {
+        bool ints = true;
+        bool reals = true;
+        bool durations = true;
+        size_t seen = 0;
+        std::unordered_set<std::string_view, column_name_hash,
+            column_name_equal>
+            distinct;
+        for (const auto& v : col.values) {
+            if (seen == sample_rows) break;
+            if (utils::strings::trim(v).empty()) continue;
+            ++seen;
+            distinct.insert(v);
+            int64_t i = 0;
+            double d = 0;
+            ints = ints && utils::strings::parse_int64(v, i);
+            reals = reals && utils::strings::parse_double(v, d);
+            durations = durations && looks_like_duration(v);
+        }
+        if (seen == 0) return column_type::text;
+        if (ints) return column_type::int64;
+        if (reals) return column_type::real;
+        if (durations) return column_type::duration;
+        if (distinct.size() * 4 <= seen) return column_type::dictionary;
+        return column_type::text;
+    }
+
+    // Parse every value in col once, into col.typed. Calling it again with
+    // a different type replaces the previous typed data.
+    static void materialise(column& col, column_type type) {
+        auto& t = col.typed;
+        t = typed_values{};
+        t.type = type;
+        if (type == column_type::dictionary) {
+            t.dict = make_dictionary(col.values);
+            return;
+        }
+        materialise_rows(col, 0);
+    }
+
+    // Parses col.values[from..] into the typed array that col already has,
+    // so that rows appended to a materialised column can be caught up.
+    static void materialise_rows(column& col, size_t from) {
+        auto& t = col.typed;
+        const auto n = col.values.size();
+
+        switch (t.type) {
+            case column_type::int64: t.ints.resize(n); break;
+            case column_type::real: t.reals.resize(n); break;
+            case column_type::duration: t.secs.resize(n); break;
+            case column_type::dictionary:
+                extend_dictionary(t.dict, col.values, from);
+                return;
+            case column_type::text: return;
+        }
+
+        if (t.type == column_type::duration && from < n) {
+            t.parse_errors += utils::strings::parse_durations(
+                col.values.data() + from, n - from, t.secs.data() + from);
+            return;
+        }
+        for (size_t i = from; i < n; ++i) {
+            if (!parse_value(t, i, col.values[i])) ++t.parse_errors;
+        }
+    }
+
+    // false if v is not empty but won't parse as t.type
+    static bool parse_value(typed_values& t, size_t i, std::string_view v) {
+        bool ok = true;
+        switch (t.type) {
+            case column_type::int64:
+                ok = utils::strings::parse_int64(v, t.ints[i]);
+                break;
+            case column_type::real:
+                ok = utils::strings::parse_double(v, t.reals[i]);
+                break;
+            case column_type::duration:
+                ok = utils::strings::parse_duration(v, t.secs[i]);
+                break;
+            default: break;
+        }
+        return ok || utils::strings::trim(v).empty();
+    }
 
     static inline auto unique_column_values(const column& col) {
         return make_unique_values(col.values);
     }
 
-    inline column* find_column(const std::string& colName) {
-        std::string uFind = my::utils::strings::to_upper(colName);
-        for (auto& c : m_columns) {
-            std::string uFound = my::utils::strings::to_upper(c.name);
-            if (uFound.size() == uFind.size()) {
-                return &c;
-            }
-        }
-        return nullptr;
+    // as unique_column_values, but also gives you a code for every row
+    static inline auto unique_column_codes(
+        const column& col, bool case_insensitive = true) {
+        return make_dictionary(col.values, case_insensitive);
     }
 
+    // case-insensitive; returns nullptr if there is no such column
+    inline column* find_column(std::string_view colName) noexcept {
+        const auto i = column_index(colName);
+        return i == npos ? nullptr : &m_columns[i];
+    }
+
+    // case-insensitive; returns npos if there is no such column. Resolve
+    // once, outside any per-row loop, and index columns() with the result.
+    size_t column_index(std::string_view colname) const noexcept {
+        auto it = this->column_keys.find(colname);
+        if (it == column_keys.end()) return npos;
+        return it->second;
+    }
+
+    // Whether to keep a binary sidecar of the parsed columns (see
+    // cache_path()) so that the next run can map it instead of parsing.
+    // The cache is used when the source's size and modification time match
+    // the ones it was made from; use_verified also checks a hash of the
+    // source, which means reading (but still not parsing) all of it.
+    enum class cache_policy { none, use, use_verified };
+
     DelimitedTextReader(
         std::string_view filepath, std::string_view delim = "\t")
         : DelimitedTextReader(filepath, delim, false) {}
 
+    // If the cache is stale or missing, the file is parsed and a new cache
+    // written. Columns you materialise afterwards only make it into the
+    // cache if you call save_cache() again.
+    DelimitedTextReader(std::string_view filepath, std::string_view delim,
+        cache_policy policy)
+        : DelimitedTextReader(true, filepath, delim) {
+        m_cache_policy = policy;
+        if (policy != cache_policy::none && load_cache()) return;
+        const auto parse_result = parse();
+        if (parse_result != 0) {
+            THROW_ERROR("Error parsing file: ", filepath,
+                std::string_view{m_serr}, "Error code: ", parse_result);
+        }
+        if (policy != cache_policy::none) {
+            if (auto e = save_cache(); e.code() != std::error_code()) {
+                m_serr = e.what(); // not fatal: we have the data
+            }
+        }
+    }
+
     private:
     DelimitedTextReader(
         bool dummy, std::string_view filepath, std::string_view delim)
@@ -81,34 +605,298 @@ struct DelimitedTextReader {
     std::string m_filepath;
     std::string m_delim;
     std::string m_serr;
+    // the bytes every value points into: m_sdata, or the mapped source
+    // file when we were loaded from the cache
+    std::string_view m_source;
+    MappedFile m_source_map;
+    cache_policy m_cache_policy{cache_policy::none};
+    bool m_from_cache{false};
+
+    // Data appended to the file since m_source was read, one chunk per
+    // refresh(). A deque, so existing chunks (and the views into them) never
+    // move.
+    struct appended_chunk {
+        uint64_t file_offset = 0;
+        std::string data;
+    };
+    std::deque<appended_chunk> m_appended;
+    uint64_t m_source_size = 0; // bytes of the file we have seen
+    uint64_t m_parsed_bytes = 0; // offset just past the last complete line
+    bool m_tail_partial{false}; // last row had no line terminator (yet)
+    // the header had no line terminator (yet): refresh() makes the columns
+    // again. Then there are no rows, and m_parsed_bytes is still 0.
+    bool m_header_partial{false};
+    size_t m_line_counter = 0;
+    std::vector<std::string_view> m_fields;
+
+    static constexpr char cache_magic[8]
+        = {'M', 'Y', 'D', 'T', 'R', 'C', 'A', 'C'};
+    static constexpr char cache_end_marker[8]
+        = {'M', 'Y', 'D', 'T', 'R', 'E', 'N', 'D'};
+    static constexpr uint32_t cache_version = 3;
+    static constexpr uint32_t cache_byte_order = 0x01020304;
+
+    // mtime in nanoseconds where the platform has them: with whole seconds,
+    // a same-size rewrite within the second would look unchanged
+    static bool source_stat(
+        const std::string& path, uint64_t& size, int64_t& mtime) noexcept {
+        struct stat st {};
+        if (stat(path.c_str(), &st) != 0) return false;
+        size = static_cast<uint64_t>(st.st_size);
+        constexpr int64_t ns = 1000000000;
+#if defined(__APPLE__)
+        mtime = static_cast<int64_t>(st.st_mtimespec.tv_sec) * ns
+            + st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+        mtime = static_cast<int64_t>(st.st_mtime) * ns;
+#else
+        mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * ns
+            + st.st_mtim.tv_nsec;
+#endif
+        return true;
+    }
+
+    void build_column_keys() {
+        column_keys.clear();
+        for (auto& col : m_columns) {
+            column_keys.insert_or_assign(col.name, col.index);
+        }
+    }
+
+    static bool view_within(std::string_view v, std::string_view in) noexcept {
+        const auto p = reinterpret_cast<uintptr_t>(v.data());
+        const auto b = reinterpret_cast<uintptr_t>(in.data());
+        return p >= b && p + v.size() <= b + in.size();
+    }
+
+    // where in the file the (non-empty) value v came from
+    uint64_t source_offset(std::string_view v) const noexcept {
+        if (view_within(v, m_source)) {
+            return static_cast<uint64_t>(v.data() - m_source.data());
+        }
+        for (auto it = m_appended.rbegin(); it != m_appended.rend(); ++it) {
+            if (view_within(v, it->data)) {
+                return it->file_offset
+                    + static_cast<uint64_t>(v.data() - it->data.data());
+            }
+        }
+        assert(0);
+        return 0;
+    }
+
+    // values are stored as offsets into the source file, so the cache
+    // never holds a second copy of the text
+    void put_views(detail::cache_writer& w,
+        const std::vector<std::string_view>& views) const {
+        std::vector<uint64_t> offsets(views.size());
+        std::vector<uint32_t> lengths(views.size());
+        for (size_t i = 0; i < views.size(); ++i) {
+            const auto v = views[i];
+            if (v.empty()) continue;
+            assert(v.size() <= UINT32_MAX);
+            offsets[i] = source_offset(v);
+            lengths[i] = static_cast<uint32_t>(v.size());
+        }
+        w.put_array(offsets);
+        w.put_array(lengths);
+    }
+
+    bool get_views(
+        detail::cache_reader& r, std::vector<std::string_view>& views) const {
+        std::vector<uint64_t> offsets;
+        std::vector<uint32_t> lengths;
+        if (!r.get_array(offsets) || !r.get_array(lengths)) return false;
+        if (offsets.size() != lengths.size()) return false;
+        views.resize(offsets.size());
+        for (size_t i = 0; i < offsets.size(); ++i) {
+            if (lengths[i] == 0) {
+                views[i] = {};
+                continue;
+            }
+            if (offsets[i] > m_source.size()
+                || lengths[i] > m_source.size() - offsets[i]) {
+                return false;
+            }
+            views[i] = m_source.substr(
+                static_cast<size_t>(offsets[i]), lengths[i]);
+        }
+        return true;
+    }
+
+    bool load_cache() {
+        MappedFile cache;
+        if (cache.open(cache_path()).code() != std::error_code()) return false;
+        if (cache.size() < sizeof(cache_magic) + sizeof(cache_end_marker)
+            || memcmp(cache.data() + cache.size() - sizeof(cache_end_marker),
+                   cache_end_marker, sizeof(cache_end_marker))
+                != 0) {
+            return false; // truncated, or not ours
+        }
+        detail::cache_reader r{cache.data(), cache.data() + cache.size()};
+
+        char magic[sizeof(cache_magic)] = {};
+        uint32_t version = 0;
+        uint32_t byte_order = 0;
+        uint64_t src_size = 0;
+        int64_t src_mtime = 0;
+        uint64_t src_hash = 0;
+        std::string delim;
+        uint64_t parsed_bytes = 0;
+        uint8_t tail_partial = 0;
+        if (!r.get_bytes(magic, sizeof(magic)) || !r.get(version)
+            || !r.get(byte_order) || !r.get(src_size) || !r.get(src_mtime)
+            || !r.get(src_hash) || !r.get_string(delim)
+            || !r.get(parsed_bytes) || !r.get(tail_partial)) {
+            return false;
+        }
+        if (memcmp(magic, cache_magic, sizeof(magic)) != 0
+            || version != cache_version || byte_order != cache_byte_order
+            || delim != m_delim) {
+            return false;
+        }
+
+        uint64_t now_size = 0;
+        int64_t now_mtime = 0;
+        if (!source_stat(m_filepath, now_size, now_mtime)
+            || now_size != src_size || now_mtime != src_mtime) {
+            return false; // stale
+        }
+        if (m_source_map.open(m_filepath).code() != std::error_code()
+            || m_source_map.size() != src_size) {
+            m_source_map.close();
+            return false;
+        }
+        m_source = m_source_map.view();
+        if (m_cache_policy == cache_policy::use_verified
+            && detail::cache_hash(m_source) != src_hash) {
+            m_source = {};
+            m_source_map.close();
+            return false;
+        }
+
+        columns_type cols;
+        uint64_t ncols = 0;
+        bool ok = r.get(ncols) && ncols <= r.remaining();
+        for (uint64_t c = 0; ok && c < ncols; ++c) {
+            auto& col = cols.emplace_back();
+            col.index = static_cast<size_t>(c);
+            uint32_t type = 0;
+            uint64_t parse_errors = 0;
+            auto& t = col.typed;
+            ok = r.get_string(col.name) && get_views(r, col.values)
+                && r.get(type) && r.get(parse_errors)
+                && type <= static_cast<uint32_t>(column_type::dictionary);
+            if (!ok) break;
+            t.type = static_cast<column_type>(type);
+            t.parse_errors = static_cast<size_t>(parse_errors);
+            switch (t.type) {
+                case column_type::int64: ok = r.get_array(t.ints); break;
+                case column_type::real: ok = r.get_array(t.reals); break;
+                case column_type::duration: ok = r.get_array(t.secs); break;
+                case column_type::dictionary: {
+                    uint8_t ci = 1;
+                    ok = get_views(r, t.dict.dictionary)
+                        && r.get_array(t.dict.codes) && r.get(ci);
+                    t.dict.case_insensitive = ci != 0;
+                    for (size_t i = 0; ok && i < t.dict.codes.size(); ++i) {
+                        ok = t.dict.codes[i] < t.dict.dictionary.size();
+                    }
+                    break;
+                }
+                case column_type::text: break;
+            }
+        }
+        if (ok) {
+            for (const auto& col : cols) {
+                ok = ok && col.values.size() == cols[0].values.size();
+            }
+        }
+        if (!ok || r.remaining() != sizeof(cache_end_marker)) {
+            m_source = {};
+            m_source_map.close();
+            return false;
+        }
+
+        m_columns = std::move(cols);
+        build_column_keys();
+        m_source_size = src_size;
+        m_parsed_bytes = parsed_bytes;
+        m_tail_partial = tail_partial != 0;
+        m_header_partial = m_parsed_bytes == 0 && !m_columns.empty();
+        m_from_cache = true;
+        return true;
+    }
 
     template <typename T>
     void make_columns(const std::vector<T>& fields, size_t lines) {
 
         for (const auto& field : fields) {
             struct column c {
-                {}, std::string(field), m_columns.size()
+                {}, std::string(field), m_columns.size(), {}
             };
             auto& col = m_columns.emplace_back(std::move(c));
-            col.values.resize(lines - 1);
+            col.values.reserve(lines);
         }
     }
 
-    // have seen some artist (Celine dion in my case) start with an ETX
-    // character or something stupid
     std::string_view sanitize(std::string_view what) {
-        static constexpr const char SPACE = ' ';
-        const char* ptr = what.data();
+        return sanitize_field(what);
+    }
 
-        for (const char c : what) {
-            if (static_cast<int>(c) < static_cast<int>(SPACE)) {
-                ++ptr;
-            } else {
-                break; // just checking for leading bad chars
+    void add_row(const std::vector<std::string_view>& fields, bool complete) {
+        if (complete && fields.size() != m_columns.size()) {
+            std::cerr << "Incorrect number of fields"
+                      << " at line:" << m_line_counter << std::endl;
+            std::cerr << std::endl
+                      << "--------------------------" << std::endl;
+        }
+        for (auto& col : m_columns) {
+            col.values.push_back(col.index < fields.size()
+                    ? sanitize(fields[col.index])
+                    : std::string_view{});
+        }
+    }
+
+    // Adds a row for every line in data, which starts at file_offset. The
+    // first line is the header, if we have no columns yet. Blank lines are
+    // skipped, and a final line without a terminator is parsed but
+    // remembered (m_tail_partial, or m_header_partial if it is the header)
+    // so refresh() can redo it once complete.
+    void parse_rows(std::string_view data, uint64_t file_offset) {
+        const auto lines = static_cast<size_t>(
+            std::count(data.begin(), data.end(), '\n') + 1);
+        for (auto& col : m_columns) {
+            col.values.reserve(col.values.size() + lines);
+        }
+
+        size_t pos = 0;
+        while (pos < data.size()) {
+            const void* nl = memchr(data.data() + pos, '\n', data.size() - pos);
+            const bool terminated = nl != nullptr;
+            const size_t end = terminated
+                ? static_cast<size_t>(static_cast<const char*>(nl) - data.data())
+                : data.size();
+            auto line = data.substr(pos, end - pos);
+            pos = end + 1;
+            ++m_line_counter;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+            if (m_columns.empty()) {
+                split_fields(line, m_delim, m_fields, false);
+                make_columns(m_fields, lines);
+                m_header_partial = !terminated;
+            } else if (!line.empty()) {
+                split_fields(line, m_delim, m_fields, false);
+                add_row(m_fields, terminated);
+                m_tail_partial = !terminated;
             }
+            if (terminated) {
+                m_parsed_bytes = file_offset + pos;
+            }
+        }
+        if (!m_tail_partial && !m_header_partial) {
+            m_parsed_bytes = file_offset + data.size();
         }
-        const char* end = what.data() + what.size();
-        return std::string_view(ptr, end - ptr);
     }
 
     int parse() {
@@ -117,51 +905,171 @@ struct DelimitedTextReader {
         if (ec.code() != std::error_code()) {
             throw ec;
         }
+        m_source = m_sdata;
+        m_source_size = m_sdata.size();
+        parse_rows(m_sdata, 0);
+        build_column_keys();
+        return 0;
+    }
 
-        auto lines = utils::strings::split<std::string_view>(m_sdata, "\r\n");
-        if (lines.empty()) {
-            lines = utils::strings::split<std::string_view>(m_sdata, "\n");
+    // undo the last row, which refresh() is about to parse again
+    void drop_last_row() {
+        --m_line_counter;
+        for (auto& col : m_columns) {
+            if (col.values.empty()) continue;
+            auto& t = col.typed;
+            const auto last = col.values.size() - 1;
+            if (!parse_value(t, last, col.values[last])) --t.parse_errors;
+            col.values.pop_back();
+            switch (t.type) {
+                case column_type::int64: t.ints.pop_back(); break;
+                case column_type::real: t.reals.pop_back(); break;
+                case column_type::duration: t.secs.pop_back(); break;
+                case column_type::dictionary: {
+                    const auto code = t.dict.codes.back();
+                    t.dict.codes.pop_back();
+                    if (code + 1 == t.dict.dictionary.size()
+                        && std::find(t.dict.codes.begin(), t.dict.codes.end(),
+                               code)
+                            == t.dict.codes.end()) {
+                        t.dict.dictionary.pop_back();
+                    }
+                    break;
+                }
+                case column_type::text: break;
+            }
         }
-        size_t line_counter = 0;
-        size_t row = 0;
+    }
 
-        for (const auto& line : lines) {
+    public:
+    // For files that are only ever appended to: parse whatever has been
+    // added since we last looked, and append it to every column, including
+    // materialised and dictionary-encoded ones. Existing rows are left as
+    // they are, except a last row that was missing its line terminator,
+    // which is parsed again. Returns the number of rows parsed, or -1 if
+    // the file has shrunk (it was replaced: make a new reader).
+    int64_t refresh() {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        if (!source_stat(m_filepath, size, mtime) || size < m_source_size) {
+            return -1;
+        }
+        if (size == m_source_size) return 0;
 
-            auto fields = utils::strings::split<std::string_view>(line, "\t");
-            if (line_counter == 0) {
-                make_columns(fields, lines.size());
-                ++line_counter;
-                continue;
-            }
+        std::fstream f;
+        utils::file_open(f, m_filepath, std::ios::in | std::ios::binary, true);
+        f.seekg(static_cast<std::streamoff>(m_parsed_bytes));
+        auto& chunk = m_appended.emplace_back();
+        chunk.file_offset = m_parsed_bytes;
+        chunk.data.resize(static_cast<size_t>(size - m_parsed_bytes));
+        f.read(chunk.data.data(), static_cast<std::streamsize>(chunk.data.size()));
+        chunk.data.resize(static_cast<size_t>(f.gcount()));
 
-            size_t col = 0;
-            int ctr = 0;
+        if (m_tail_partial) {
+            drop_last_row();
+            m_tail_partial = false;
+        }
+        if (m_header_partial) {
+            // there are no rows yet: start the columns over
+            --m_line_counter;
+            m_columns.clear();
+            column_keys.clear();
+            m_header_partial = false;
+        }
+        const auto first_new = rowcount();
+        const bool had_columns = !m_columns.empty();
+        m_source_size = chunk.file_offset + chunk.data.size();
+        parse_rows(chunk.data, chunk.file_offset);
+        if (!had_columns) build_column_keys();
+        for (auto& col : m_columns) {
+            materialise_rows(col, first_new);
+        }
+        return static_cast<int64_t>(rowcount() - first_new);
+    }
 
-            for (const auto& field : fields) {
-                auto& c = m_columns.at(col++);
-                auto& v = c.values;
-                v.at(row) = sanitize(field);
-                ++ctr;
-            }
+    // where the binary cache for this file lives
+    std::string cache_path() const { return m_filepath + ".dtrcache"; }
+    // true if we mapped the cache rather than parsing the file
+    bool loaded_from_cache() const noexcept { return m_from_cache; }
 
-            if (fields.size() != m_columns.size()) {
-                std::cerr << "Incorrect number of fields"
-                          << " at line:" << line_counter << std::endl;
-                std::cerr << std::endl
-                          << "--------------------------" << std::endl;
-            }
-            ++row;
-            ++line_counter;
+    // Write the cache for the current columns, including any that have
+    // been materialised. Fails if the file has changed since we read it.
+    std::system_error save_cache() const {
+        uint64_t src_size = 0;
+        int64_t src_mtime = 0;
+        if (!source_stat(m_filepath, src_size, src_mtime)) {
+            return {errno, std::system_category(),
+                std::string("cannot stat ") + m_filepath};
+        }
+        if (src_size != m_source_size) {
+            return {EINVAL, std::system_category(),
+                m_filepath + " has changed since it was read"};
         }
 
-        for (auto& col : m_columns) {
-            column_keys[col.name] = &col;
+        // the file is m_source, overlaid by each appended chunk in turn
+        detail::cache_hasher hasher;
+        uint64_t hashed = 0;
+        for (size_t i = 0; i <= m_appended.size(); ++i) {
+            const auto piece = i == 0
+                ? m_source
+                : std::string_view(m_appended[i - 1].data);
+            const auto upto = i < m_appended.size()
+                ? m_appended[i].file_offset
+                : m_source_size;
+            const auto piece_offset
+                = i == 0 ? 0 : m_appended[i - 1].file_offset;
+            assert(hashed >= piece_offset && upto >= hashed);
+            hasher.update(piece.substr(static_cast<size_t>(hashed - piece_offset),
+                static_cast<size_t>(upto - hashed)));
+            hashed = upto;
         }
 
-        return 0;
+        const auto path = cache_path();
+        std::fstream f;
+        if (auto e = utils::file_open(f, path,
+                std::ios::out | std::ios::binary | std::ios::trunc);
+            e.code() != std::error_code()) {
+            return e;
+        }
+
+        detail::cache_writer w{f};
+        w.put_bytes(cache_magic, sizeof(cache_magic));
+        w.put(cache_version);
+        w.put(cache_byte_order);
+        w.put(src_size);
+        w.put(src_mtime);
+        w.put(hasher.finish());
+        w.put_string(m_delim);
+        w.put(m_parsed_bytes);
+        w.put(static_cast<uint8_t>(m_tail_partial));
+        w.put(static_cast<uint64_t>(m_columns.size()));
+        for (const auto& col : m_columns) {
+            const auto& t = col.typed;
+            w.put_string(col.name);
+            put_views(w, col.values);
+            w.put(static_cast<uint32_t>(t.type));
+            w.put(static_cast<uint64_t>(t.parse_errors));
+            switch (t.type) {
+                case column_type::int64: w.put_array(t.ints); break;
+                case column_type::real: w.put_array(t.reals); break;
+                case column_type::duration: w.put_array(t.secs); break;
+                case column_type::dictionary:
+                    put_views(w, t.dict.dictionary);
+                    w.put_array(t.dict.codes);
+                    w.put(static_cast<uint8_t>(t.dict.case_insensitive));
+                    break;
+                case column_type::text: break;
+            }
+        }
+        w.put_bytes(cache_end_marker, sizeof(cache_end_marker));
+        f.flush();
+        if (!f) {
+            return {errno, std::system_category(),
+                std::string("failed to write ") + path};
+        }
+        return {std::error_code()};
     }
 
-    public:
     const columns_type& columns() const noexcept { return m_columns; }
     const std::string& last_error() const noexcept { return m_serr; }
     size_t rowcount() const noexcept {
@@ -169,9 +1077,8 @@ struct DelimitedTextReader {
         return m_columns[0].values.size();
     }
     const struct column* column(std::string_view colname) const noexcept {
-        auto it = this->column_keys.find(std::string(colname));
-        if (it == column_keys.end()) return nullptr;
-        return it->second;
+        const auto i = column_index(colname);
+        return i == npos ? nullptr : &m_columns[i];
     }
 
     const struct column* column(size_t index) {
@@ -179,6 +1086,32 @@ struct DelimitedTextReader {
         return &this->m_columns[index];
     }
 
+    // Parse the named column into a typed, contiguous array (see
+    // typed_values). Returns nullptr if there is no such column.
+    const struct column* materialise(
+        std::string_view colname, column_type type) {
+        auto* col = find_column(colname);
+        if (col == nullptr) return nullptr;
+        materialise(*col, type);
+        return col;
+    }
+
+    // As above, but the type is inferred from the column's contents.
+    const struct column* materialise(std::string_view colname) {
+        auto* col = find_column(colname);
+        if (col == nullptr) return nullptr;
+        materialise(*col, infer_type(*col));
+        return col;
+    }
+
+    // Infer and materialise every column. Columns that look like plain
+    // text are left as they are.
+    void materialise_all() {
+        for (auto& col : m_columns) {
+            materialise(col, infer_type(col));
+        }
+    }
+
     // get an *approximation* of the length of the row data
     size_t get_row_data_len(
         size_t index, std::string_view delim, bool quoted) const noexcept {
@@ -193,34 +1126,152 @@ struct DelimitedTextReader {
         return len - delim.size();
     }
 
+    // the exact length of the row data, as rowData() would produce it
+    size_t row_data_size(size_t index, std::string_view delim, bool quoted,
+        bool escaped) const noexcept {
+        if (m_columns.empty()) return 0;
+        size_t len = 0;
+        for (const auto& col : m_columns) {
+            const auto v = col.values[index];
+            len += escaped ? utils::strings::escaped_size(v) : v.size();
+        }
+        len += (m_columns.size() - 1) * delim.size();
+        if (quoted) {
+            len += m_columns.size() * 2;
+        }
+        return len;
+    }
+
+    // Writes the row straight into dest, which must have room for
+    // row_data_size() chars. Returns one past the last char written.
+    char* write_row(char* dest, size_t row_index, std::string_view delim,
+        bool quoted, bool escaped) const noexcept {
+        const auto col_count = m_columns.size();
+        for (const auto& col : m_columns) {
+            const auto v = col.values[row_index];
+            if (quoted) *dest++ = '\'';
+            if (escaped) {
+                dest = utils::strings::escape_to(v, dest);
+            } else {
+                memcpy(dest, v.data(), v.size());
+                dest += v.size();
+            }
+            if (quoted) *dest++ = '\'';
+            if (col.index < col_count - 1) {
+                memcpy(dest, delim.data(), delim.size());
+                dest += delim.size();
+            }
+        }
+        return dest;
+    }
+
     void rowData(std::string& out, size_t row_index, bool clear_out = true,
         std::string_view delim = ",", bool quoted = true, bool escaped = true) {
 
         if (clear_out) out.clear();
         const auto col_count = m_columns.size();
         if (col_count == 0) return;
-        const auto& first_column = m_columns[0];
         const auto& vals = m_columns[0].values;
         if (vals.empty()) return;
         const auto row_count = vals.size();
         assert(row_index < row_count);
+        (void)row_count;
 
-        for (const auto& col : m_columns) {
-            if (quoted) {
-                out.append("'");
-            }
-            if (escaped)
-                out.append(utils::strings::escape(col.values[row_index]));
-            else
-                out.append(col.values[row_index]);
+        const auto start = out.size();
+        out.resize(start + row_data_size(row_index, delim, quoted, escaped));
+        const char* end
+            = write_row(out.data() + start, row_index, delim, quoted, escaped);
+        assert(end == out.data() + out.size());
+        (void)end;
+    }
 
-            if (quoted) {
-                out.append("'");
-            }
-            if (col.index < col_count - 1) {
-                out.append(delim);
-            }
-        } // for
+    // Appends rows [first_row, first_row + count) to out, each followed by
+    // eol, sizing out exactly once up front. count is clamped to the rows
+    // available. Returns the number of rows written.
+    size_t append_rows(std::string& out, size_t first_row = 0,
+        size_t count = npos, std::string_view delim = ",", bool quoted = true,
+        bool escaped = true, std::string_view eol = "\n") const {
+
+        const auto rows = rowcount();
+        if (m_columns.empty() || first_row >= rows) return 0;
+        count = (std::min)(count, rows - first_row);
+        const auto last = first_row + count;
+
+        size_t total = count * eol.size();
+        for (size_t r = first_row; r < last; ++r) {
+            total += row_data_size(r, delim, quoted, escaped);
+        }
+
+        auto start = out.size();
+        out.resize(start + total);
+        char* dest = out.data() + start;
+        for (size_t r = first_row; r < last; ++r) {
+            dest = write_row(dest, r, delim, quoted, escaped);
+            memcpy(dest, eol.data(), eol.size());
+            dest += eol.size();
+        }
+        assert(dest == out.data() + out.size());
+        return count;
+    }
+
+    // As append_rows(), but streams to os through a buffer of about
+    // flush_bytes, so each write to the stream is a large one. Returns the
+    // number of rows written, which is fewer than asked for if os fails
+    // part way through (os is left in its failed state).
+    size_t export_rows(std::ostream& os, size_t first_row = 0,
+        size_t count = npos, std::string_view delim = ",", bool quoted = true,
+        bool escaped = true, std::string_view eol = "\n",
+        size_t flush_bytes = 4 * 1024 * 1024) const {
+
+        const auto rows = rowcount();
+        if (m_columns.empty() || first_row >= rows) return 0;
+        count = (std::min)(count, rows - first_row);
+        const auto last = first_row + count;
+
+        std::string buf;
+        buf.reserve(flush_bytes);
+        size_t written = 0;
+        size_t buffered = 0;
+        const auto flush = [&] {
+            os.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+            buf.clear();
+            if (os) written += buffered;
+            buffered = 0;
+        };
+        for (size_t r = first_row; r < last && os; ++r) {
+            const auto start = buf.size();
+            buf.resize(
+                start + row_data_size(r, delim, quoted, escaped) + eol.size());
+            char* dest = write_row(buf.data() + start, r, delim, quoted, escaped);
+            memcpy(dest, eol.data(), eol.size());
+            ++buffered;
+            if (buf.size() >= flush_bytes) flush();
+        }
+        if (!buf.empty() && os) flush();
+        return written;
+    }
+
+    // export every row to a file, as with utils::file_write_all()
+    std::system_error export_rows_to_file(const std::string& filepath,
+        std::string_view delim = ",", bool quoted = true, bool escaped = true,
+        std::string_view eol = "\n", bool throw_on_fail = false) const {
+
+        std::fstream f;
+        if (auto opened = utils::file_open(
+                f, filepath, std::ios::out | std::ios::binary, throw_on_fail);
+            opened.code() != std::error_code()) {
+            return opened;
+        }
+        const auto written
+            = export_rows(f, 0, npos, delim, quoted, escaped, eol);
+        f.flush();
+        if (!f || written != rowcount()) {
+            auto e = std::system_error(errno, std::system_category(),
+                std::string("failed to write ") + filepath);
+            if (throw_on_fail) throw e;
+            return e;
+        }
+        return {std::error_code()};
     }
 
     void rowData(bool clear_out, std::stringstream& out, size_t row_index,
@@ -0,0 +1,331 @@
+// This is an independent project of an individual developer. Dear PVS-Studio,
+// please check it.
+
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java:
+// http://www.viva64.com
+#ifndef MY_DELIM_QUERY_HPP
+#define MY_DELIM_QUERY_HPP
+
+// Column-at-a-time filtering over DelimitedTextReader columns. Each
+// predicate scans one column and produces a selection (one bit per row);
+// selections combine with & | ~, and rows() turns the result into row
+// indices. No row strings are ever built.
+//
+//  using namespace my::query;
+//  auto sel = equals(*rd.column("gender"), "F")
+//      & range(*rd.column("dur"), 90, 600);
+//  for (auto row : sel.rows()) { ... }
+//
+// range() needs a materialised (typed) column; equals() and in_set() are
+// integer compares on dictionary-encoded columns.
+
+#include "my_delim_file.hpp"
+#include <cstdint>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace my {
+namespace query {
+
+    // (struct, because DelimitedTextReader::column() hides the type)
+    using column_t = struct DelimitedTextReader::column;
+    using value_type = DelimitedTextReader::column_type;
+
+    // A bitmap with one bit per row.
+    class selection {
+        std::vector<uint64_t> m_words;
+        size_t m_rows = 0;
+
+        void clear_tail() noexcept {
+            if (const auto extra = m_rows % 64; extra != 0) {
+                m_words.back() &= (uint64_t{1} << extra) - 1;
+            }
+        }
+
+        public:
+        explicit selection(size_t rows = 0, bool all = false)
+            : m_words((rows + 63) / 64, all ? ~uint64_t{0} : 0)
+            , m_rows(rows) {
+            clear_tail();
+        }
+
+        size_t size() const noexcept { return m_rows; }
+        const std::vector<uint64_t>& words() const noexcept { return m_words; }
+        std::vector<uint64_t>& words() noexcept { return m_words; }
+
+        bool test(size_t row) const noexcept {
+            return (m_words[row / 64] >> (row % 64)) & 1U;
+        }
+        void set(size_t row, bool on = true) noexcept {
+            const auto bit = uint64_t{1} << (row % 64);
+            if (on) {
+                m_words[row / 64] |= bit;
+            } else {
+                m_words[row / 64] &= ~bit;
+            }
+        }
+
+        // how many rows are selected
+        size_t count() const noexcept {
+            size_t ret = 0;
+            for (const auto w : m_words) {
+                ret += static_cast<size_t>(popcount(w));
+            }
+            return ret;
+        }
+
+        // the selected row indices, in order
+        std::vector<size_t> rows() const {
+            std::vector<size_t> ret;
+            ret.reserve(count());
+            for (size_t i = 0; i < m_words.size(); ++i) {
+                auto w = m_words[i];
+                while (w != 0) {
+                    ret.push_back(i * 64 + static_cast<size_t>(ctz(w)));
+                    w &= w - 1;
+                }
+            }
+            return ret;
+        }
+
+        selection& operator&=(const selection& rhs) noexcept {
+            assert(rhs.m_rows == m_rows);
+            for (size_t i = 0; i < m_words.size(); ++i) {
+                m_words[i] &= rhs.m_words[i];
+            }
+            return *this;
+        }
+        selection& operator|=(const selection& rhs) noexcept {
+            assert(rhs.m_rows == m_rows);
+            for (size_t i = 0; i < m_words.size(); ++i) {
+                m_words[i] |= rhs.m_words[i];
+            }
+            return *this;
+        }
+        selection operator~() const {
+            selection ret(*this);
+            for (auto& w : ret.m_words) {
+                w = ~w;
+            }
+            ret.clear_tail();
+            return ret;
+        }
+        friend selection operator&(selection lhs, const selection& rhs) {
+            lhs &= rhs;
+            return lhs;
+        }
+        friend selection operator|(selection lhs, const selection& rhs) {
+            lhs |= rhs;
+            return lhs;
+        }
+
+        static int popcount(uint64_t w) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_popcountll(w);
+#else
+            int n = 0;
+            for (; w != 0; w &= w - 1) {
+                ++n;
+            }
+            return n;
+#endif
+        }
+        static int ctz(uint64_t w) noexcept {
+            assert(w != 0);
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctzll(w);
+#else
+            int n = 0;
+            for (; (w & 1U) == 0; w >>= 1) {
+                ++n;
+            }
+            return n;
+#endif
+        }
+    };
+
+    // Builds a selection 64 rows at a time from pred(row). The inner loop
+    // has no branches, so over contiguous typed arrays the compiler is free
+    // to vectorise it.
+    template <typename PRED>
+    selection select_if(size_t rows, PRED&& pred) {
+        selection ret(rows);
+        auto& words = ret.words();
+        for (size_t w = 0; w < words.size(); ++w) {
+            const size_t base = w * 64;
+            const size_t n = (std::min)(size_t{64}, rows - base);
+            uint64_t bits = 0;
+            for (size_t b = 0; b < n; ++b) {
+                bits |= static_cast<uint64_t>(pred(base + b) ? 1 : 0) << b;
+            }
+            words[w] = bits;
+        }
+        return ret;
+    }
+
+    namespace detail {
+        template <typename T, typename V>
+        selection range_of(const std::vector<T>& v, V lo, V hi) {
+            const T* p = v.data();
+            return select_if(v.size(), [p, lo, hi](size_t i) {
+                return (p[i] >= lo) & (p[i] <= hi);
+            });
+        }
+
+        // a bit per dictionary code, saying whether that code is wanted
+        template <typename PRED>
+        std::vector<uint8_t> matching_codes(
+            const dictionary_encoded& dict, PRED&& pred) {
+            std::vector<uint8_t> ret(dict.distinct());
+            for (size_t i = 0; i < ret.size(); ++i) {
+                ret[i] = pred(dict.dictionary[i]) ? 1 : 0;
+            }
+            return ret;
+        }
+
+        inline selection select_codes(
+            const dictionary_encoded& dict, const std::vector<uint8_t>& want) {
+            const auto* codes = dict.codes.data();
+            const auto* w = want.data();
+            return select_if(dict.codes.size(),
+                [codes, w](size_t i) { return w[codes[i]] != 0; });
+        }
+
+        inline bool equal(std::string_view a, std::string_view b,
+            bool case_insensitive) noexcept {
+            return case_insensitive ? column_name_equal()(a, b) : a == b;
+        }
+
+        inline bool starts_with(std::string_view s, std::string_view prefix,
+            bool case_insensitive) noexcept {
+            if (s.size() < prefix.size()) return false;
+            return equal(s.substr(0, prefix.size()), prefix, case_insensitive);
+        }
+
+        // Rows of a dictionary column whose value satisfies pred(value, ci),
+        // with the query's own case_insensitive, whatever the dictionary was
+        // built with. Usually that's a test per code; but when the
+        // dictionary ignores case and the query doesn't, a code stands for
+        // several spellings, so the codes only narrow it down and each
+        // candidate row's own text decides.
+        template <typename PRED>
+        selection select_dictionary(
+            const column_t& col, bool case_insensitive, PRED&& pred) {
+            const auto& dict = col.typed.dict;
+            const bool ci = case_insensitive || dict.case_insensitive;
+            const auto want = matching_codes(
+                dict, [&](std::string_view s) { return pred(s, ci); });
+            if (!dict.case_insensitive || case_insensitive) {
+                return select_codes(dict, want);
+            }
+            const auto* codes = dict.codes.data();
+            const auto* v = col.values.data();
+            const auto* w = want.data();
+            return select_if(dict.codes.size(), [&](size_t i) {
+                return w[codes[i]] != 0 && pred(v[i], false);
+            });
+        }
+    } // namespace detail
+
+    // Rows whose value is value. On a dictionary column whose
+    // case-sensitivity matches the query's (or that is case-sensitive)
+    // this is an integer compare per row.
+    inline selection equals(const column_t& col, std::string_view value,
+        bool case_insensitive = false) {
+        const auto& t = col.typed;
+        if (t.type == value_type::dictionary) {
+            return detail::select_dictionary(col, case_insensitive,
+                [value](std::string_view s, bool ci) {
+                    return detail::equal(s, value, ci);
+                });
+        }
+        const auto* v = col.values.data();
+        if (case_insensitive) {
+            return select_if(col.values.size(), [v, value](size_t i) {
+                return column_name_equal()(v[i], value);
+            });
+        }
+        return select_if(
+            col.values.size(), [v, value](size_t i) { return v[i] == value; });
+    }
+
+    // Rows whose value starts with prefix.
+    inline selection prefix(const column_t& col, std::string_view prefix,
+        bool case_insensitive = false) {
+        const auto& t = col.typed;
+        if (t.type == value_type::dictionary) {
+            return detail::select_dictionary(col, case_insensitive,
+                [prefix](std::string_view s, bool ci) {
+                    return detail::starts_with(s, prefix, ci);
+                });
+        }
+        const auto* v = col.values.data();
+        return select_if(col.values.size(), [&](size_t i) {
+            return detail::starts_with(v[i], prefix, case_insensitive);
+        });
+    }
+
+    // Rows whose value is any one of values.
+    inline selection in_set(const column_t& col,
+        const std::vector<std::string_view>& values,
+        bool case_insensitive = false) {
+        const std::unordered_set<std::string_view, column_name_hash,
+            column_name_equal>
+            ci_set(values.begin(), values.end());
+        const std::unordered_set<std::string_view> set(
+            values.begin(), values.end());
+        const auto& t = col.typed;
+        if (t.type == value_type::dictionary) {
+            return detail::select_dictionary(col, case_insensitive,
+                [&](std::string_view s, bool ci) {
+                    return ci ? ci_set.count(s) != 0 : set.count(s) != 0;
+                });
+        }
+        const auto* v = col.values.data();
+        if (case_insensitive) {
+            return select_if(col.values.size(),
+                [&ci_set, v](size_t i) { return ci_set.count(v[i]) != 0; });
+        }
+        return select_if(col.values.size(),
+            [&set, v](size_t i) { return set.count(v[i]) != 0; });
+    }
+
+    // Rows with lo <= value <= hi. col must have been materialised as
+    // int64, real or duration (seconds); throws otherwise.
+    inline selection range(const column_t& col, double lo, double hi) {
+        const auto& t = col.typed;
+        switch (t.type) {
+            case value_type::int64:
+                return detail::range_of(t.ints, lo, hi);
+            case value_type::real:
+                return detail::range_of(t.reals, lo, hi);
+            case value_type::duration:
+                return detail::range_of(t.secs, lo, hi);
+            default: break;
+        }
+        THROW_ERROR("range() needs a numeric, materialised column, and ",
+            col.name, " is not one");
+        return selection{};
+    }
+
+    // As above, but compares whole numbers exactly.
+    inline selection range(const column_t& col, int64_t lo, int64_t hi) {
+        const auto& t = col.typed;
+        if (t.type == value_type::int64) {
+            return detail::range_of(t.ints, lo, hi);
+        }
+        if (t.type == value_type::duration) {
+            return detail::range_of(t.secs, lo, hi);
+        }
+        return range(col, static_cast<double>(lo), static_cast<double>(hi));
+    }
+
+    inline selection range(const column_t& col, int lo, int hi) {
+        return range(col, static_cast<int64_t>(lo), static_cast<int64_t>(hi));
+    }
+
+} // namespace query
+} // namespace my
+
+#endif // MY_DELIM_QUERY_HPP
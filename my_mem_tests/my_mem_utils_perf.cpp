@@ -11,20 +11,16 @@ using std::vector;
 using namespace std;
 using namespace my;
 
-vector<std::string> make_random_strings(size_t howMany, size_t string_len = 32) // NOLINT
+// one buffer for the lot, so setting up doesn't swamp what we measure
+utils::strings::random_strings make_random_strings(size_t howMany, size_t string_len = 32) // NOLINT
 {
-    std::vector<std::string> strings;
     printf("Making %zu random strings of length: %zu ...\n", howMany, string_len); // NOLINT
-    strings.reserve(howMany);
-    for (size_t i = 0; i < howMany; ++i)
-    {
-        strings.push_back(utils::strings::random_string(string_len));
-    }
+    utils::strings::random_strings strings(howMany, string_len);
     printf("Making %zu random strings, complete.\n", howMany); // NOLINT
     return strings;
 }
 
-auto test_arena(const std::vector<std::string> &v, Arena **a, bool &reset) // NOLINT
+auto test_arena(const utils::strings::random_strings &v, Arena **a, bool &reset) // NOLINT
 {
     volatile uint64_t ret = 0;
     const auto start_time = my::stopwatch::now_ms();
@@ -47,7 +43,7 @@ auto test_arena(const std::vector<std::string> &v, Arena **a, bool &reset) // NO
         }
         if (ptr != nullptr)
         {
-            memcpy((char *)ptr, s.c_str(), l + 1);
+            memcpy((char *)ptr, s.data(), l + 1);
         }
         ret += strlen((char *)ptr); // need this to avoid optimising away
     };
@@ -56,7 +52,7 @@ auto test_arena(const std::vector<std::string> &v, Arena **a, bool &reset) // NO
     return my::stopwatch::now_ms() - start_time;
 }
 
-auto test_malloc(const std::vector<std::string> &v) //NOLINT
+auto test_malloc(const utils::strings::random_strings &v) //NOLINT
 {
 
     volatile uint64_t ret = 0;
@@ -67,7 +63,7 @@ auto test_malloc(const std::vector<std::string> &v) //NOLINT
 
         const auto l = s.size(); //NOLINT
         volatile char *ptr = (char *)malloc(l + 1); // NOLINT
-        memcpy((void *)ptr, s.c_str(), l + 1);
+        memcpy((void *)ptr, s.data(), l + 1);
         ret -= strlen((char *)ptr); // do not optimise me away!
         if (firstptr == nullptr)
         {
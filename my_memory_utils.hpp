@@ -5,7 +5,9 @@
 #include <cstring>
 
 #ifndef _WIN32
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <unistd.h>
 #else
 #include <Windows.h>
 #endif
@@ -151,6 +153,154 @@ class Arena
         mapmem(capacity());
     }
 };
+
+// Read-only mapping of a whole file. The pages are only read in as they are
+// touched, so "opening" even a huge file is close to free.
+class MappedFile
+{
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+
+  public:
+    MappedFile() noexcept = default;
+    ~MappedFile()
+    {
+        close();
+    }
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(const MappedFile &other) = delete;
+    MappedFile(MappedFile &&other) noexcept
+    {
+        *this = std::move(other);
+    }
+    MappedFile &operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            m_data = other.m_data;
+            m_size = other.m_size;
+            other.m_data = nullptr;
+            other.m_size = 0;
+#ifdef _WIN32
+            m_file = other.m_file;
+            m_mapping = other.m_mapping;
+            other.m_file = INVALID_HANDLE_VALUE;
+            other.m_mapping = nullptr;
+#endif
+        }
+        return *this;
+    }
+
+    // An empty file opens successfully, with data() == nullptr.
+    std::system_error open(const std::string &path)
+    {
+        close();
+#ifndef _WIN32
+        const int fd = ::open(path.c_str(), O_RDONLY); // NOLINT
+        if (fd < 0)
+        {
+            return {errno, std::system_category(), std::string("failed to open ") + path};
+        }
+        struct stat st
+        {
+        };
+        if (fstat(fd, &st) != 0)
+        {
+            const int e = errno;
+            ::close(fd);
+            return {e, std::system_category(), std::string("failed to stat ") + path};
+        }
+        m_size = static_cast<size_t>(st.st_size);
+        if (m_size > 0)
+        {
+            void *p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0); // NOLINT
+            if (p == MAP_FAILED) // NOLINT
+            {
+                const int e = errno;
+                ::close(fd);
+                m_size = 0;
+                return {e, std::system_category(), std::string("failed to map ") + path};
+            }
+            m_data = static_cast<const char *>(p);
+        }
+        ::close(fd); // the mapping keeps its own reference
+#else
+        m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            return {static_cast<int>(GetLastError()), std::system_category(), std::string("failed to open ") + path};
+        }
+        LARGE_INTEGER sz{};
+        GetFileSizeEx(m_file, &sz);
+        m_size = static_cast<size_t>(sz.QuadPart);
+        if (m_size > 0)
+        {
+            m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_mapping != nullptr)
+            {
+                m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            }
+            if (m_data == nullptr)
+            {
+                const auto e = static_cast<int>(GetLastError());
+                close();
+                return {e, std::system_category(), std::string("failed to map ") + path};
+            }
+        }
+#endif
+        return {std::error_code()};
+    }
+
+    void close() noexcept
+    {
+#ifndef _WIN32
+        if (m_data != nullptr)
+        {
+            munmap((void *)m_data, m_size); // NOLINT
+        }
+#else
+        if (m_data != nullptr)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mapping != nullptr)
+        {
+            CloseHandle(m_mapping);
+        }
+        if (m_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_file);
+        }
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    [[nodiscard]] const char *data() const noexcept
+    {
+        return m_data;
+    }
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return m_size;
+    }
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+    [[nodiscard]] std::string_view view() const noexcept
+    {
+        return {m_data, m_size};
+    }
+};
 } // namespace my
 
 #endif // MY_MEMORY_UTILS_HPP
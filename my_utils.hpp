@@ -10,15 +10,24 @@
 #include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <charconv>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <shared_mutex>
 #include <sstream>
 #include <string_view>
 #include <sys/stat.h> // yup, windows has it, for checking file exist
 #include <system_error>
+#include <type_traits>
 #include <vector>
 
 #ifdef _WIN32
@@ -29,6 +38,15 @@
 #include <unistd.h> // getcwd
 #endif
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MY_UTILS_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MY_UTILS_SSE2 1
+#endif
+
 #include "my_assert.hpp"
 #include <map>
 #include <ostream>
@@ -76,39 +94,408 @@ static inline std::string system_error_string(int e) // NOLINT
     return ec.message();
 }
 
+namespace detail
+{
+// unaligned 8 byte load
+static inline uint64_t load_u64(const char *p) noexcept // NOLINT
+{
+    uint64_t w = 0;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+// the last n (< 8) bytes, zero padded
+static inline uint64_t load_u64_tail(const char *p, size_t n) noexcept // NOLINT
+{
+    uint64_t w = 0;
+    memcpy(&w, p, n);
+    return w;
+}
+
+constexpr uint64_t swar_ones = 0x0101010101010101ULL;
+constexpr uint64_t swar_high = 0x8080808080808080ULL;
+
+// SWAR: 0x80 in each byte of w that lies in [lo, hi], 0 in every other byte
+// (bytes >= 0x80 never match)
+static inline uint64_t swar_in_range(uint64_t w, unsigned char lo, unsigned char hi) noexcept // NOLINT
+{
+    const uint64_t low7 = w & ~swar_high;
+    const uint64_t ge_lo = low7 + swar_ones * (0x80U - lo);
+    const uint64_t gt_hi = low7 + swar_ones * (0x80U - hi - 1U);
+    return ge_lo & ~gt_hi & ~w & swar_high;
+}
+// the ASCII letters in 8 packed bytes, upper-cased; other bytes unchanged
+static inline uint64_t swar_to_upper(uint64_t w) noexcept // NOLINT
+{
+    return w ^ (swar_in_range(w, 'a', 'z') >> 2);
+}
+static inline uint64_t swar_to_lower(uint64_t w) noexcept // NOLINT
+{
+    return w ^ (swar_in_range(w, 'A', 'Z') >> 2);
+}
+
+// 64x64 -> 128 bit multiply, folded to 64 bits (wyhash's "mum")
+static inline uint64_t mul_fold(uint64_t a, uint64_t b) noexcept // NOLINT
+{
+#if defined(__SIZEOF_INT128__)
+    const auto r = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64U);
+#else
+    const uint64_t lo_lo = (a & 0xffffffffU) * (b & 0xffffffffU);
+    const uint64_t hi_lo = (a >> 32U) * (b & 0xffffffffU);
+    const uint64_t lo_hi = (a & 0xffffffffU) * (b >> 32U);
+    const uint64_t hi_hi = (a >> 32U) * (b >> 32U);
+    const uint64_t cross = (lo_lo >> 32U) + (hi_lo & 0xffffffffU) + lo_hi;
+    const uint64_t upper = (hi_lo >> 32U) + (cross >> 32U) + hi_hi;
+    const uint64_t lower = (cross << 32U) | (lo_lo & 0xffffffffU);
+    return upper ^ lower;
+#endif
+}
+
+enum class case_op
+{
+    upper,
+    lower,
+    flip
+};
+
+template <case_op OP> static inline uint64_t swar_case(uint64_t w) noexcept // NOLINT
+{
+    if constexpr (OP == case_op::upper)
+    {
+        return swar_to_upper(w);
+    }
+    else if constexpr (OP == case_op::lower)
+    {
+        return swar_to_lower(w);
+    }
+    else
+    {
+        return w ^ ((swar_in_range(w, 'a', 'z') | swar_in_range(w, 'A', 'Z')) >> 2);
+    }
+}
+
+template <case_op OP> static inline unsigned char scalar_case(unsigned char c) noexcept // NOLINT
+{
+    if constexpr (OP == case_op::upper)
+    {
+        return static_cast<unsigned char>(c - ((c - unsigned{'a'} < 26U) << 5U)); // NOLINT
+    }
+    else if constexpr (OP == case_op::lower)
+    {
+        return static_cast<unsigned char>(c + ((c - unsigned{'A'} < 26U) << 5U)); // NOLINT
+    }
+    else
+    {
+        return static_cast<unsigned char>(c ^ (((c | 32U) - unsigned{'a'} < 26U) << 5U)); // NOLINT
+    }
+}
+
+// In the vector kernels, (v - (lo + 128)) wraps the 26 letters from lo
+// onwards to -128..-103, so one signed compare finds them.
+#ifdef MY_UTILS_SSE2
+template <case_op OP> static inline __m128i sse2_case(__m128i v) noexcept // NOLINT
+{
+    const auto letters = [v](char lo) {
+        return _mm_cmplt_epi8(_mm_sub_epi8(v, _mm_set1_epi8(static_cast<char>(lo + 128))),
+                              _mm_set1_epi8(static_cast<char>(-128 + 26)));
+    };
+    __m128i mask{};
+    if constexpr (OP == case_op::upper)
+    {
+        mask = letters('a');
+    }
+    else if constexpr (OP == case_op::lower)
+    {
+        mask = letters('A');
+    }
+    else
+    {
+        mask = _mm_or_si128(letters('a'), letters('A'));
+    }
+    return _mm_xor_si128(v, _mm_and_si128(mask, _mm_set1_epi8(0x20)));
+}
+#endif
+#ifdef MY_UTILS_AVX2
+template <case_op OP> static inline __m256i avx2_case(__m256i v) noexcept // NOLINT
+{
+    const auto letters = [v](char lo) {
+        return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + 26)),
+                                 _mm256_sub_epi8(v, _mm256_set1_epi8(static_cast<char>(lo + 128))));
+    };
+    __m256i mask{};
+    if constexpr (OP == case_op::upper)
+    {
+        mask = letters('a');
+    }
+    else if constexpr (OP == case_op::lower)
+    {
+        mask = letters('A');
+    }
+    else
+    {
+        mask = _mm256_or_si256(letters('a'), letters('A'));
+    }
+    return _mm256_xor_si256(v, _mm256_and_si256(mask, _mm256_set1_epi8(0x20)));
+}
+#endif
+
+// Changes the case of the ASCII letters in p[0, n), 32 / 16 / 8 bytes at a
+// time as the target allows; every other byte, including UTF-8, is left as
+// it is.
+template <case_op OP> static inline void ascii_case(char *p, size_t n) noexcept // NOLINT
+{
+    size_t i = 0;
+#ifdef MY_UTILS_AVX2
+    for (; i + 32 <= n; i += 32)
+    {
+        auto *q = reinterpret_cast<__m256i *>(p + i); // NOLINT
+        _mm256_storeu_si256(q, avx2_case<OP>(_mm256_loadu_si256(q)));
+    }
+#endif
+#ifdef MY_UTILS_SSE2
+    for (; i + 16 <= n; i += 16)
+    {
+        auto *q = reinterpret_cast<__m128i *>(p + i); // NOLINT
+        _mm_storeu_si128(q, sse2_case<OP>(_mm_loadu_si128(q)));
+    }
+#endif
+    for (; i + 8 <= n; i += 8)
+    {
+        const uint64_t w = swar_case<OP>(load_u64(p + i));
+        memcpy(p + i, &w, sizeof(w));
+    }
+    for (; i < n; ++i)
+    {
+        p[i] = static_cast<char>(scalar_case<OP>(static_cast<unsigned char>(p[i]))); // NOLINT
+    }
+}
+} // namespace detail
+
+// wyrand: a small, fast 64-bit generator with good statistical quality.
+// Not for anything security related. Usable with <random> distributions.
+class wyrand
+{
+  public:
+    using result_type = uint64_t;
+    explicit wyrand(uint64_t seed = 0) noexcept : m_state(seed)
+    {
+    }
+    static constexpr result_type min() noexcept
+    {
+        return 0;
+    }
+    static constexpr result_type max() noexcept
+    {
+        return ~result_type{0};
+    }
+    result_type operator()() noexcept
+    {
+        m_state += 0xa0761d6478bd642fULL;
+        return detail::mul_fold(m_state, m_state ^ 0xe7037ed1a0b428dbULL);
+    }
+
+  private:
+    uint64_t m_state;
+};
+
+namespace detail
+{
+// fills p[0..n) with random letters and digits. The random bytes go in
+// 8 at a time; the mapping onto [0-9A-Za-z] has no table and no branches,
+// so the compiler can vectorise it.
+static inline void fill_alnum(char *p, size_t n, wyrand &rng) noexcept // NOLINT
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const uint64_t r = rng();
+        memcpy(p + i, &r, 8); // NOLINT
+    }
+    if (i < n)
+    {
+        const uint64_t r = rng();
+        memcpy(p + i, &r, n - i); // NOLINT
+    }
+    auto *u = reinterpret_cast<unsigned char *>(p); // NOLINT
+    for (i = 0; i < n; ++i)
+    {
+        // 0..61, then '0'..'9', 'A'..'Z', 'a'..'z'
+        const unsigned idx = (u[i] * 62U) >> 8U; // NOLINT
+        u[i] = static_cast<unsigned char>(idx + '0' + (idx >= 10 ? 7U : 0U) + (idx >= 36 ? 6U : 0U)); // NOLINT
+    }
+}
+} // namespace detail
+
+// A random string of letters and digits. A seed > 0 restarts the (shared,
+// not thread-safe) generator, so the same seed gives the same strings.
+// For lots of them at once, see random_strings.
 static inline std::string random_string(std::size_t length, int seed = -1) // NOLINT
 {
-    static const std::string CHARACTERS = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwx"
-                                          "yz";
-    // auto seed =
-    // std::chrono::system_clock::now().time_since_epoch().count();
-    //  std::mt19937 generator {seed};
-    static std::random_device random_device;
-    static std::mt19937 generator(random_device());
+    static wyrand generator{std::random_device{}()};
     if (seed > 0)
     {
-        generator = std::mt19937(seed);
+        generator = wyrand(static_cast<uint64_t>(seed));
     }
-    std::uniform_int_distribution<size_t> distribution(size_t(0), CHARACTERS.size() - 1);
+    std::string ret(length, '\0');
+    detail::fill_alnum(ret.data(), length, generator);
+    return ret;
+}
 
-    std::string random_string;
+// count random strings of letters and digits, all in one buffer: one
+// allocation for the text and one for the views, however many strings.
+// The same seed always gives the same strings. Each string is followed
+// by a '\0', so data() of any of them is also a C string. The views point
+// into the buffer, so this can be moved (the views move with it) but not
+// copied.
+//
+//  const random_strings keys(1'000'000, 32); // all 32 long
+//  const auto mixed = random_strings::ranged(1'000'000, 8, 64);
+//  for (std::string_view k : keys) { ... }
+class random_strings
+{
+  public:
+    random_strings(size_t count, size_t length, uint64_t seed = 0x5eed) : random_strings(count, length, length, seed)
+    {
+    }
+    // lengths uniform in [min_length, max_length]. A factory rather than a
+    // constructor, which (count, min, max) would mistake for (count,
+    // length, seed).
+    static random_strings ranged(size_t count, size_t min_length, size_t max_length, uint64_t seed = 0x5eed)
+    {
+        return random_strings(count, min_length, max_length, seed);
+    }
+    random_strings(const random_strings &) = delete;
+    random_strings &operator=(const random_strings &) = delete;
+    random_strings(random_strings &&rhs) noexcept
+    {
+        take(rhs);
+    }
+    random_strings &operator=(random_strings &&rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            take(rhs);
+        }
+        return *this;
+    }
 
-    for (std::size_t i = 0; i < length; ++i)
+    size_t size() const noexcept
+    {
+        return m_views.size();
+    }
+    bool empty() const noexcept
+    {
+        return m_views.empty();
+    }
+    std::string_view operator[](size_t i) const noexcept
+    {
+        return m_views[i];
+    }
+    auto begin() const noexcept
     {
-        random_string += CHARACTERS[distribution(generator)];
+        return m_views.begin();
+    }
+    auto end() const noexcept
+    {
+        return m_views.end();
+    }
+    const std::vector<std::string_view> &views() const noexcept
+    {
+        return m_views;
     }
 
-    return random_string;
+  private:
+    std::string m_text;
+    std::vector<std::string_view> m_views;
+
+    // lengths uniform in [min_length, max_length]; see ranged()
+    random_strings(size_t count, size_t min_length, size_t max_length, uint64_t seed)
+    {
+        assert(min_length <= max_length);
+        wyrand rng(seed);
+        std::vector<size_t> lengths(count, min_length);
+        size_t total = count * (min_length + 1);
+        if (max_length != min_length)
+        {
+            const uint64_t span = max_length - min_length + 1;
+            total = 0;
+            for (auto &len : lengths)
+            {
+                len = min_length + static_cast<size_t>(detail::mul_fold(rng(), span) % span);
+                total += len + 1;
+            }
+        }
+        m_text.resize(total);
+        m_views.reserve(count);
+        char *p = m_text.data();
+        for (const auto len : lengths)
+        {
+            m_views.emplace_back(p, len);
+            p += len + 1; // NOLINT
+        }
+        // all the text at once, then put the terminators back
+        detail::fill_alnum(m_text.data(), total, rng);
+        for (const auto v : m_views)
+        {
+            const_cast<char *>(v.data())[v.size()] = '\0'; // NOLINT
+        }
+    }
+
+    // a short enough text lives inside the string itself, and doesn't move
+    // with it: then the views have to be pointed at the new copy
+    void take(random_strings &rhs) noexcept
+    {
+        const char *old = rhs.m_text.data();
+        m_text = std::move(rhs.m_text);
+        m_views = std::move(rhs.m_views);
+        if (m_text.data() != old)
+        {
+            for (auto &v : m_views)
+            {
+                v = std::string_view(m_text.data() + (v.data() - old), v.size()); // NOLINT
+            }
+        }
+        rhs.m_text.clear();
+        rhs.m_views.clear();
+    }
+};
+
+// true if every byte is < 0x80
+[[maybe_unused]] static inline bool is_ascii(std::string_view sv) noexcept // NOLINT
+{
+    const char *p = sv.data();
+    const size_t n = sv.size();
+    size_t i = 0;
+#ifdef MY_UTILS_SSE2
+    for (; i + 16 <= n; i += 16)
+    {
+        if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i))) != 0) // NOLINT
+        {
+            return false;
+        }
+    }
+#endif
+    for (; i + 8 <= n; i += 8)
+    {
+        if ((detail::load_u64(p + i) & detail::swar_high) != 0)
+        {
+            return false;
+        }
+    }
+    for (; i < n; ++i)
+    {
+        if (static_cast<unsigned char>(p[i]) >= 0x80U)
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 [[maybe_unused]] static inline const char *to_lower_branchless(std::string &sv) // NOLINT
 {
     char *d = sv.data(); // NOLINT
-    for (size_t i = 0; i < sv.size(); ++i)
-    {
-        auto *const c = reinterpret_cast<unsigned char *>(&d[i]); // NOLINT
-        *c += (*c - 'A' < 26U) << 5;                              // NOLINT
-    }
+    detail::ascii_case<detail::case_op::lower>(d, sv.size());
     return d;
 }
 [[maybe_unused]] static inline const char *to_upper_branchless(std::string &sv) // NOLINT
@@ -118,10 +505,7 @@ static inline std::string random_string(std::size_t length, int seed = -1) // NO
         return nullptr;
     }
     char *d = sv.data(); // NOLINT
-    for (auto i = 0; i < (int)sv.size(); ++i)
-    {
-        d[i] -= ((unsigned char)d[i] - 'a' < 26U) << 5; //-V108 //NOLINT
-    }
+    detail::ascii_case<detail::case_op::upper>(d, sv.size());
     return d;
 }
 
@@ -132,10 +516,7 @@ static inline std::string random_string(std::size_t length, int seed = -1) // NO
         return;
     }
     char *d = (char *)sv.data(); // NOLINT
-    for (auto i = 0; i < (int)sv.size(); ++i)
-    {
-        d[i] -= ((unsigned char)d[i] - 'a' < 26U) << 5; //-V108 //NOLINT
-    }
+    detail::ascii_case<detail::case_op::upper>(d, sv.size());
 }
 
 [[maybe_unused]] static inline const char *flip_case_branchless(std::string &sv) // NOLINT
@@ -145,12 +526,32 @@ static inline std::string random_string(std::size_t length, int seed = -1) // NO
         return nullptr;
     }
     char *d = sv.data(); // NOLINT
-    for (auto i = 0; i < (int)sv.size(); ++i)
+    detail::ascii_case<detail::case_op::flip>(d, sv.size());
+    return d;
+}
+
+// ASCII case-insensitive hash: "Abba" and "ABBA" hash the same. Case is
+// folded 8 bytes at a time as the words are mixed in, so nothing is copied
+// or allocated, and it is safe to call from any thread.
+[[maybe_unused]] static inline size_t ci_hash(std::string_view sv, uint64_t seed = 0) noexcept // NOLINT
+{
+    constexpr uint64_t p0 = 0xa0761d6478bd642fULL;
+    constexpr uint64_t p1 = 0xe7037ed1a0b428dbULL;
+    constexpr uint64_t p2 = 0x8ebc6af09c88c6e3ULL;
+    constexpr uint64_t p3 = 0x589965cc75374cc3ULL;
+    const char *p = sv.data();
+    const size_t n = sv.size();
+    uint64_t h = seed ^ p0 ^ (n * p3);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
     {
-        auto *c = (unsigned char *)&d[i];                     //-V108 //NOLINT
-        *c ^= ((*c | 32U) - 'a' < 26) << 5; /* toggle case */ // NOLINT
+        h = detail::mul_fold(detail::swar_to_upper(detail::load_u64(p + i)) ^ p1, h ^ p2);
     }
-    return d;
+    if (i < n)
+    {
+        h = detail::mul_fold(detail::swar_to_upper(detail::load_u64_tail(p + i, n - i)) ^ p1, h ^ p3);
+    }
+    return static_cast<size_t>(detail::mul_fold(h ^ p0, n ^ p1));
 }
 
 [[maybe_unused]] static inline void make_lower(std::string &s) // NOLINT
@@ -265,38 +666,132 @@ static inline std::string random_string(std::size_t length, int seed = -1) // NO
     return s;
 }
 
+// ASCII case-insensitive equality, without copying: 16 (SSE2) or 8 bytes
+// at a time, folding case only for the blocks that differ as they are.
+[[maybe_unused]] static inline bool ci_equal(std::string_view a, std::string_view b) noexcept // NOLINT
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    const char *pa = a.data();
+    const char *pb = b.data();
+    const size_t n = a.size();
+    if (pa == pb)
+    {
+        return true;
+    }
+    size_t i = 0;
+#ifdef MY_UTILS_SSE2
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pa + i)); // NOLINT
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pb + i)); // NOLINT
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xffff)
+        {
+            continue;
+        }
+        const __m128i la = detail::sse2_case<detail::case_op::lower>(va);
+        const __m128i lb = detail::sse2_case<detail::case_op::lower>(vb);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(la, lb)) != 0xffff)
+        {
+            return false;
+        }
+    }
+#endif
+    for (; i + 8 <= n; i += 8)
+    {
+        const uint64_t wa = detail::load_u64(pa + i);
+        const uint64_t wb = detail::load_u64(pb + i);
+        if (wa != wb && detail::swar_to_lower(wa) != detail::swar_to_lower(wb))
+        {
+            return false;
+        }
+    }
+    if (i < n)
+    {
+        const uint64_t wa = detail::load_u64_tail(pa + i, n - i);
+        const uint64_t wb = detail::load_u64_tail(pb + i, n - i);
+        return wa == wb || detail::swar_to_lower(wa) == detail::swar_to_lower(wb);
+    }
+    return true;
+}
+
+// ASCII case-insensitive three-way compare: < 0, 0 or > 0. Orders as if
+// both were lower-cased and compared as unsigned bytes (like strcasecmp in
+// the "C" locale), a shorter prefix first. Blocks that match are skipped a
+// word at a time; only the first differing one is walked byte by byte.
+[[maybe_unused]] static inline int ci_compare(std::string_view a, std::string_view b) noexcept // NOLINT
+{
+    const char *pa = a.data();
+    const char *pb = b.data();
+    const size_t n = (std::min)(a.size(), b.size());
+    size_t i = 0;
+    const auto bytewise = [pa, pb](size_t from, size_t to) {
+        for (size_t k = from; k < to; ++k)
+        {
+            const int ca = detail::scalar_case<detail::case_op::lower>(static_cast<unsigned char>(pa[k]));
+            const int cb = detail::scalar_case<detail::case_op::lower>(static_cast<unsigned char>(pb[k]));
+            if (ca != cb)
+            {
+                return ca - cb;
+            }
+        }
+        return 0;
+    };
+#ifdef MY_UTILS_SSE2
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i la =
+            detail::sse2_case<detail::case_op::lower>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pa + i))); // NOLINT
+        const __m128i lb =
+            detail::sse2_case<detail::case_op::lower>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pb + i))); // NOLINT
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(la, lb)) != 0xffff)
+        {
+            return bytewise(i, i + 16);
+        }
+    }
+#endif
+    for (; i + 8 <= n; i += 8)
+    {
+        if (detail::swar_to_lower(detail::load_u64(pa + i)) != detail::swar_to_lower(detail::load_u64(pb + i)))
+        {
+            return bytewise(i, i + 8);
+        }
+    }
+    if (const int r = bytewise(i, n); r != 0)
+    {
+        return r;
+    }
+    return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+}
+
 // helper for std::unordered_map in c++20 with heterogeneous lookup,
 // assuming your map is declared something like:
 // using my_hetero_type
 // = std::unordered_map<std::string, column_t, string_hash, ci_equal<>>;
-// NOTE: NOT THREAD SAFE!!
+// Thread safe, and never allocates: see ci_hash().
 struct string_hash_transparent_ci
 {
     using is_transparent = void;
-    static inline std::string temp; // NOLINT
     [[nodiscard]] size_t operator()(char const *txt) const noexcept
     {
-
-        temp = txt;
-        to_upper_branchless(temp);
-        return std::hash<std::string>{}(temp);
+        return ci_hash(txt);
     }
 
     [[nodiscard]] size_t operator()(const std::string_view txt) const noexcept
     {
-        temp.assign(txt);
-        to_upper_branchless(temp);
-        return std::hash<std::string>{}(temp);
+        return ci_hash(txt);
     }
 
     [[nodiscard]] size_t operator()(const std::string &txt) const noexcept
     {
-        temp = txt;
-        to_upper_branchless(temp);
-        return std::hash<std::string>{}(temp);
+        return ci_hash(txt);
     }
 
-    template <typename T> [[nodiscard]] size_t operator()(T &&) const noexcept // NOLINT
+    // anything that is not a string
+    template <typename T, std::enable_if_t<!std::is_convertible_v<T, std::string_view>, int> = 0>
+    [[nodiscard]] size_t operator()(T &&) const noexcept // NOLINT
     {
         assert(0);
         return 0;
@@ -319,22 +814,15 @@ template <> struct ci_equal_to<void>
 {
 
     using is_transparent = int;
-    // NOTE: Yes, I know left & right are COPIES: this is kinda
-    // required to do a branchless comparison
-    [[nodiscard]] static bool compare(std::string left, std::string right) noexcept
+    // no copies: see ci_equal()
+    [[nodiscard]] static bool compare(std::string_view left, std::string_view right) noexcept
     {
-        if (left.size() != right.size())
-        {
-            return false;
-        }
-        to_upper_branchless(left);
-        to_upper_branchless(right);
-        return left == right;
+        return ci_equal(left, right);
     }
 
     template <typename T1, typename T2> [[nodiscard]] bool operator()(T1 &&left, T2 &&right) const noexcept // NOLINT
     {
-        return compare(std::string(left), std::string(right));
+        return ci_equal(std::string_view(left), std::string_view(right));
     }
 };
 
@@ -362,10 +850,11 @@ static inline bool compare_less_nocase_c(const char a, const char b) // NOLINT
     return tolower(a) < tolower(b);
 }
 
+// lower-case ordering, as compare_less_nocase_c, but a block at a time and
+// without the locale: see ci_compare()
 static inline bool compare_less_nocase(const std::string_view a, const std::string_view b) noexcept // NOLINT
 {
-    // ReSharper disable once CppUseRangeAlgorithm
-    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), compare_less_nocase_c);
+    return ci_compare(a, b) < 0;
 }
 
 struct ci_less_lib_c
@@ -373,7 +862,7 @@ struct ci_less_lib_c
     using is_transparent = int;
     bool operator()(const std::string &lhs, const std::string &rhs) const noexcept
     {
-        return strcasecmp(lhs.c_str(), rhs.c_str()) < 0;
+        return ci_compare(lhs, rhs) < 0;
     }
     bool operator()(const std::string_view a, const std::string_view b) const noexcept // NOLINT
     {
@@ -429,13 +918,135 @@ template <typename... Args> static inline std::string concat_into(std::stringstr
     return std::string{ss.str()};
 }
 
-// way slower than cat(), but accepts any streamable type in the
-// arguments If you need faster, use concat_into and provide your own
-// stringstream object.
-template <typename... Args> static inline std::string concat(Args &&...args)
+namespace detail
+{
+// true if v points into s's buffer (which growing s would free)
+static inline bool views_into(const std::string &s, std::string_view v) noexcept
+{
+    const std::less<const char *> before;
+    return !v.empty() && !before(v.data(), s.data()) && before(v.data(), s.data() + s.capacity()); // NOLINT
+}
+
+template <typename T> constexpr bool is_char_v = std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>;
+
+// One argument of concat(), formatted as operator<< would (default
+// stream flags) but without a stream: strings are referred to, not
+// copied; numbers go through to_chars into a small buffer; anything else
+// is streamed, as a last resort.
+class concat_piece
+{
+  public:
+    template <typename T> explicit concat_piece(const T &v)
+    {
+        using U = std::decay_t<T>;
+        if constexpr (std::is_convertible_v<const T &, std::string_view>)
+        {
+            m_view = std::string_view(v);
+        }
+        else if constexpr (is_char_v<U>)
+        {
+            m_buf[0] = static_cast<char>(v); // NOLINT
+            m_len = 1;
+        }
+        else if constexpr (std::is_same_v<U, bool>)
+        {
+            m_buf[0] = v ? '1' : '0'; // NOLINT
+            m_len = 1;
+        }
+        else if constexpr (std::is_integral_v<U>)
+        {
+            const auto r = std::to_chars(m_buf, m_buf + sizeof(m_buf), v); // NOLINT
+            m_len = static_cast<size_t>(r.ptr - m_buf);
+        }
+        else if constexpr (std::is_floating_point_v<U>)
+        {
+#if defined(__cpp_lib_to_chars) || defined(_MSC_VER)
+            // what a default-formatted stream gives: %g
+            const auto r = std::to_chars(m_buf, m_buf + sizeof(m_buf), v, std::chars_format::general, 6); // NOLINT
+            m_len = static_cast<size_t>(r.ptr - m_buf);
+#else
+            // older libc++ (Apple) has no floating point to_chars
+            const int n = snprintf(m_buf, sizeof(m_buf), "%g", static_cast<double>(v)); // NOLINT
+            m_len = n > 0 ? (std::min)(static_cast<size_t>(n), sizeof(m_buf) - 1) : 0;
+#endif
+        }
+        else
+        {
+            std::ostringstream ss;
+            ss << v;
+            m_owned = std::move(ss).str();
+            m_streamed = true;
+        }
+    }
+
+    std::string_view view() const noexcept
+    {
+        if (m_streamed)
+        {
+            return m_owned;
+        }
+        if (m_len != 0)
+        {
+            return {m_buf, m_len}; // NOLINT
+        }
+        return m_view;
+    }
+
+  private:
+    std::string_view m_view;
+    char m_buf[48] = {}; // NOLINT
+    size_t m_len = 0;
+    bool m_streamed = false;
+    std::string m_owned;
+};
+} // namespace detail
+
+// Appends all of args to out, growing it at most once: every argument is
+// formatted first, so the exact size is known before anything is copied.
+// Accepts anything concat() does, including out itself (or a view of it).
+template <typename... Args> static inline std::string &concat_append(std::string &out, const Args &...args)
+{
+    if constexpr (sizeof...(Args) != 0)
+    {
+        const detail::concat_piece pieces[] = {detail::concat_piece(args)...};
+        size_t size = out.size();
+        bool aliased = false;
+        for (const auto &p : pieces)
+        {
+            size += p.view().size();
+            aliased = aliased || detail::views_into(out, p.view());
+        }
+        if (aliased)
+        {
+            // growing out in place would free text still to be copied
+            std::string ret;
+            ret.reserve(size);
+            ret.append(out);
+            for (const auto &p : pieces)
+            {
+                ret.append(p.view());
+            }
+            out.swap(ret);
+            return out;
+        }
+        out.reserve(size);
+        for (const auto &p : pieces)
+        {
+            out.append(p.view());
+        }
+    }
+    return out;
+}
+
+// Concatenates any mix of strings, chars, numbers and streamable types,
+// with the same output as streaming them one after the other (floats to 6
+// significant digits). Strings and numbers never touch a stream, and the
+// result is allocated once. See concat_append to reuse a buffer.
+template <typename... Args> static inline std::string concat(const Args &...args)
 {
-    std::stringstream stream;
-    return concat_into(stream, std::forward<Args>(args)...);
+    std::string ret;
+    concat_append(ret, args...);
+    return ret;
 }
 
 template <typename... ARGS> static inline void throw_runtime_error(ARGS &&...args)
@@ -448,152 +1059,844 @@ template <typename... ARGS> static inline void throw_runtime_error(ARGS &&...arg
 #define THROW_ERROR(...) utils::strings::throw_runtime_error(__FILE__, ':', __LINE__, "\r\n", __VA_ARGS__) // NOLINT
 #define THROW_RUNTIME_ERROR THROW_ERROR
 
-template <typename... Args> std::size_t catSize(Args &&...args)
-{
+template <typename... Args> std::size_t catSize(Args &&...args)
+{
+
+    return (... + std::forward<Args>(args).size());
+    // const auto totalSize = (0 + ... + strings.length());
+}
+
+// appends args to s, with at most one allocation. Same as concat_append().
+template <typename... Args> void cat(std::string &s, const Args &...args) // NOLINT
+{
+    concat_append(s, args...);
+}
+
+// Legacy: splits on each occurrence of the whole of needle. Returns no
+// tokens at all if needle is not found, and drops an empty last token. See
+// split_view for a version that does not allocate.
+template <typename RESULT_TYPE>
+static inline std::vector<RESULT_TYPE> split2(const std::string_view haystack, const std::string_view needle = " ")
+{
+    std::vector<RESULT_TYPE> tokens;
+    const auto *it = haystack.begin(); // NOLINT
+    const auto *tok_it = it;
+
+    while (it < haystack.end())
+    {
+        it = std::search(it, haystack.end(), needle.begin(), needle.end());
+
+        if (tok_it == haystack.begin() && it == haystack.end())
+        {
+            return tokens; // nothing found
+        }
+        tokens.emplace_back(std::move(RESULT_TYPE(tok_it, it - tok_it)));
+        it += needle.size(); // NOLINT
+        tok_it = it;
+    }
+    return tokens;
+}
+
+// Legacy: finds the next delimiter with find_first_of (any one of the
+// characters), but then skips delimiters.size() characters, so it only
+// behaves as you'd expect with a single-character delimiter. Empty tokens
+// are kept, except an empty last one. Kept as-is for existing callers:
+// new code should use split_view / split_into, which say which of the two
+// they mean.
+template <typename RESULT_TYPE>
+static inline std::vector<RESULT_TYPE> split(std::string_view str, const std::string_view delimiters = " ")
+{
+    std::vector<RESULT_TYPE> tokens;
+    // Start at the beginning
+    std::string::size_type lastPos = 0;
+    // Find position of the first delimiter
+    std::string::size_type pos = str.find_first_of(delimiters, lastPos);
+
+    // While we still have string to read
+    while (std::string::npos != pos && std::string::npos != lastPos)
+    {
+        // Found a token, add it to the vector
+        tokens.emplace_back(str.substr(lastPos, pos - lastPos));
+        // Look at the next token instead of skipping delimiters
+        lastPos = pos + delimiters.size();
+        // Find the position of the next delimiter
+        pos = str.find_first_of(delimiters, lastPos);
+    }
+
+    // Push the last token
+    const auto sz = str.size() - lastPos; // NOLINT
+    if (sz && sz != std::string::npos)
+    {
+        tokens.emplace_back(str.substr(lastPos, sz));
+    }
+    return tokens;
+}
+
+enum class split_mode
+{
+    sequence, // the delimiter is the whole string: "\r\n" splits at CRLF only
+    any_of    // any one of the delimiter characters splits
+};
+
+// Lazily splits a string_view into string_views; nothing is allocated or
+// copied. Tokens run between delimiters, so n delimiters always make n + 1
+// tokens (empty ones included, and "" is a single empty token). An empty
+// delimiter never matches. Single-character delimiters are found with
+// memchr.
+//
+//  for (auto field : split_view(line, "\t")) { ... }
+class split_view
+{
+  public:
+    split_view(std::string_view s, std::string_view delims, split_mode mode = split_mode::sequence) noexcept
+        : m_s(s), m_delims(delims), m_mode(mode)
+    {
+        if (m_mode == split_mode::any_of)
+        {
+            for (const char c : delims)
+            {
+                const auto u = static_cast<unsigned char>(c);
+                m_set[u / 64] |= uint64_t{1} << (u % 64); // NOLINT
+            }
+        }
+    }
+
+    class iterator
+    {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view *;
+        using reference = std::string_view;
+
+        iterator() = default;
+        iterator(const split_view *view, size_t pos) noexcept : m_view(view), m_pos(pos)
+        {
+            load();
+        }
+        std::string_view operator*() const noexcept
+        {
+            return m_token;
+        }
+        const std::string_view *operator->() const noexcept
+        {
+            return &m_token;
+        }
+        iterator &operator++() noexcept
+        {
+            m_pos = m_next;
+            load();
+            return *this;
+        }
+        iterator operator++(int) noexcept // NOLINT
+        {
+            iterator ret(*this);
+            ++*this;
+            return ret;
+        }
+        bool operator==(const iterator &rhs) const noexcept
+        {
+            return m_pos == rhs.m_pos;
+        }
+        bool operator!=(const iterator &rhs) const noexcept
+        {
+            return m_pos != rhs.m_pos;
+        }
+
+      private:
+        const split_view *m_view = nullptr;
+        size_t m_pos = std::string_view::npos; // start of the token; npos at the end
+        size_t m_next = std::string_view::npos;
+        std::string_view m_token;
+
+        void load() noexcept
+        {
+            if (m_pos == std::string_view::npos)
+            {
+                return;
+            }
+            size_t len = 0;
+            const size_t found = m_view->find(m_pos, len);
+            if (found == std::string_view::npos)
+            {
+                m_token = m_view->m_s.substr(m_pos);
+                m_next = std::string_view::npos;
+            }
+            else
+            {
+                m_token = m_view->m_s.substr(m_pos, found - m_pos);
+                m_next = found + len;
+            }
+        }
+    };
+
+    iterator begin() const noexcept
+    {
+        return iterator(this, 0);
+    }
+    iterator end() const noexcept // NOLINT
+    {
+        return iterator(this, std::string_view::npos);
+    }
+
+    // where the next delimiter at or after from starts (and its length in
+    // len), or npos
+    size_t find(size_t from, size_t &len) const noexcept
+    {
+        const char *p = m_s.data();
+        const size_t n = m_s.size();
+        if (m_delims.empty() || from >= n)
+        {
+            return std::string_view::npos;
+        }
+        if (m_delims.size() == 1 || m_mode == split_mode::sequence)
+        {
+            len = m_delims.size();
+            const char first = m_delims[0];
+            while (from + len <= n)
+            {
+                const void *hit = memchr(p + from, first, n - from - len + 1);
+                if (hit == nullptr)
+                {
+                    return std::string_view::npos;
+                }
+                const auto at = static_cast<size_t>(static_cast<const char *>(hit) - p);
+                if (len == 1 || memcmp(p + at + 1, m_delims.data() + 1, len - 1) == 0)
+                {
+                    return at;
+                }
+                from = at + 1;
+            }
+            return std::string_view::npos;
+        }
+        len = 1;
+        for (size_t i = from; i < n; ++i)
+        {
+            const auto u = static_cast<unsigned char>(p[i]);
+            if ((m_set[u / 64] >> (u % 64)) & 1U) // NOLINT
+            {
+                return i;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+  private:
+    std::string_view m_s;
+    std::string_view m_delims;
+    split_mode m_mode;
+    uint64_t m_set[4] = {}; // any_of: a bit per byte value // NOLINT
+};
+
+// Splits into out, which is cleared first; its capacity is reused, so in a
+// loop over lines this allocates nothing once out is big enough. Same
+// tokens as split_view. Returns the number of tokens.
+template <typename RESULT_TYPE = std::string_view>
+static inline size_t split_into(std::vector<RESULT_TYPE> &out, std::string_view s, std::string_view delims,
+                                split_mode mode = split_mode::sequence)
+{
+    out.clear();
+    for (const auto token : split_view(s, delims, mode))
+    {
+        out.emplace_back(token);
+    }
+    return out.size();
+}
+
+namespace detail
+{
+// [[[D:]H:]M:]S[.fff], surrounding whitespace allowed. Fields after the
+// first are range checked (seconds and minutes < 60, hours < 24 after
+// days); the first may be as big as it likes, within int32_t seconds.
+static inline bool parse_duration(std::string_view sv, int64_t &whole, double &frac) noexcept // NOLINT
+{
+    sv = trim(sv);
+    if (sv.empty())
+    {
+        return false;
+    }
+    int64_t fields[4] = {}; // NOLINT
+    size_t count = 0;
+    const char *p = sv.data();
+    const char *const end = p + sv.size(); // NOLINT
+    frac = 0;
+    for (;;)
+    {
+        if (count == 4 || p == end || *p < '0' || *p > '9')
+        {
+            return false;
+        }
+        const auto [ptr, ec] = std::from_chars(p, end, fields[count]); // NOLINT
+        if (ec != std::errc())
+        {
+            return false;
+        }
+        ++count;
+        p = ptr;
+        if (p == end)
+        {
+            break;
+        }
+        if (*p == '.')
+        {
+            // fractional seconds: last field only
+            double scale = 0.1;
+            if (++p == end) // NOLINT
+            {
+                return false;
+            }
+            for (; p != end; ++p) // NOLINT
+            {
+                if (*p < '0' || *p > '9')
+                {
+                    return false;
+                }
+                frac += (*p - '0') * scale;
+                scale /= 10;
+            }
+            break;
+        }
+        if (*p++ != ':') // NOLINT
+        {
+            return false;
+        }
+    }
+
+    static const int64_t limits[] = {60, 60, 24}; // secs, mins, hours // NOLINT
+    static const int64_t mults[] = {1, 60, 3600, 3600 * 24}; // NOLINT
+    whole = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const size_t place = count - i - 1; // 0 for seconds
+        const auto v = fields[i]; // NOLINT
+        if (i != 0 && v >= limits[place]) // NOLINT
+        {
+            return false;
+        }
+        if (v > (std::numeric_limits<int32_t>::max)() / mults[place]) // NOLINT
+        {
+            return false;
+        }
+        whole += v * mults[place]; // NOLINT
+    }
+    return whole <= (std::numeric_limits<int32_t>::max)();
+}
+
+// "MM:SS" exactly, checked and converted as one 8-byte word
+static inline bool parse_mmss(const char *p, int32_t &out) noexcept // NOLINT
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    (void)p;
+    (void)out;
+    return false;
+#else
+    const uint64_t w = load_u64_tail(p, 5);
+    if (swar_in_range(w, '0', '9') != 0x0000008080008080ULL || ((w >> 16) & 0xFFU) != ':')
+    {
+        return false;
+    }
+    const uint64_t d = w - 0x0000003030003030ULL;
+    const auto mins = ((d & 0xFFU) * 10) + ((d >> 8) & 0xFFU);
+    const auto secs = (((d >> 24) & 0xFFU) * 10) + ((d >> 32) & 0xFFU);
+    if (secs >= 60)
+    {
+        return false;
+    }
+    out = static_cast<int32_t>((mins * 60) + secs);
+    return true;
+#endif
+}
+} // namespace detail
+
+// Parses a duration, [[[D:]H:]M:]S[.fff] (surrounding whitespace allowed),
+// into seconds. Returns false, leaving secs untouched, if sv is not one.
+[[maybe_unused]] static inline bool parse_duration(std::string_view sv, double &secs) noexcept // NOLINT
+{
+    int64_t whole = 0;
+    double frac = 0;
+    if (!detail::parse_duration(sv, whole, frac))
+    {
+        return false;
+    }
+    secs = static_cast<double>(whole) + frac;
+    return true;
+}
+
+// As above, in whole seconds: any fraction is dropped.
+[[maybe_unused]] static inline bool parse_duration(std::string_view sv, int32_t &secs) noexcept // NOLINT
+{
+    if (sv.size() == 5 && detail::parse_mmss(sv.data(), secs))
+    {
+        return true;
+    }
+    int64_t whole = 0;
+    double frac = 0;
+    if (!detail::parse_duration(sv, whole, frac))
+    {
+        return false;
+    }
+    secs = static_cast<int32_t>(whole);
+    return true;
+}
+
+// Parses n durations into out[0..n), whole seconds. Empty (or all
+// whitespace) values give 0; so do values that won't parse, which are also
+// counted: returns the number of those. A column of fixed-width MM:SS, the
+// common case, never leaves the 8-byte fast path.
+template <typename SV>
+static inline size_t parse_durations(const SV *in, size_t n, int32_t *out) noexcept // NOLINT
+{
+    size_t errors = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const std::string_view v(in[i]); // NOLINT
+        auto &secs = out[i]; // NOLINT
+        if (v.size() == 5 && detail::parse_mmss(v.data(), secs))
+        {
+            continue;
+        }
+        if (!parse_duration(v, secs))
+        {
+            secs = 0;
+            if (!trim(v).empty())
+            {
+                ++errors;
+            }
+        }
+    }
+    return errors;
+}
+
+template <typename SV> static inline size_t parse_durations(const std::vector<SV> &in, std::vector<int32_t> &out)
+{
+    out.resize(in.size());
+    return parse_durations(in.data(), in.size(), out.data());
+}
+
+// Seconds in a duration such as 3:11 or 1:02:03. Well-formed input goes
+// through parse_duration(); anything else gets the old, lenient, atol()-
+// style reading, so existing callers see the same numbers as ever.
+[[maybe_unused]] static inline int HHMMSSto_secs(std::string_view sdur)
+{
+    int32_t secs = 0;
+    if (parse_duration(sdur, secs))
+    {
+        return secs;
+    }
+    // as split<>(sdur, ":") gave: an empty last part is dropped
+    std::string_view parts[5]; // NOLINT
+    size_t count = 0;
+    for (const auto part : split_view(sdur, ":"))
+    {
+        if (count == 5)
+        {
+            assert(0);
+            return -1;
+        }
+        parts[count++] = part; // NOLINT
+    }
+    if (count > 0 && parts[count - 1].empty())
+    {
+        --count;
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+    if (count > 4)
+    { //-V112
+        assert(0);
+        return -1;
+    }
+
+    const int mults[] = {1, 60, 3600, 3600 * 24}; // NOLINT
+    int retval = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        // as atol(): leading space and sign, then digits until the first
+        // non-digit; 0 if there are none
+        auto part = ltrim(parts[i]); // NOLINT
+        if (!part.empty() && part[0] == '+')
+        {
+            part.remove_prefix(1);
+        }
+        long this_val = 0;
+        std::from_chars(part.data(), part.data() + part.size(), this_val);
+        retval += static_cast<int>(this_val) * mults[count - i - 1]; // NOLINT
+    }
+
+    return retval;
+}
+
+// Parses the whole of sv (surrounding whitespace allowed) as a base-10
+// integer. Returns false, leaving out untouched, on anything else.
+[[maybe_unused]] static inline bool parse_int64(std::string_view sv, int64_t &out) noexcept // NOLINT
+{
+    sv = trim(sv);
+    if (!sv.empty() && sv.front() == '+')
+    {
+        sv.remove_prefix(1);
+        if (!sv.empty() && sv.front() == '-')
+        {
+            return false; // "+-3": from_chars would take the '-'
+        }
+    }
+    if (sv.empty())
+    {
+        return false;
+    }
+    int64_t v = 0;
+    const auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), v); // NOLINT
+    if (ec != std::errc() || ptr != sv.data() + sv.size())
+    {
+        return false;
+    }
+    out = v;
+    return true;
+}
+
+// As parse_int64, but for floating point.
+[[maybe_unused]] static inline bool parse_double(std::string_view sv, double &out) noexcept // NOLINT
+{
+    sv = trim(sv);
+    if (!sv.empty() && sv.front() == '+')
+    {
+        sv.remove_prefix(1);
+        if (!sv.empty() && sv.front() == '-')
+        {
+            return false; // "+-3": from_chars would take the '-'
+        }
+    }
+    if (sv.empty())
+    {
+        return false;
+    }
+    double v = 0;
+#if defined(__cpp_lib_to_chars) || defined(_MSC_VER)
+    const auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), v); // NOLINT
+    if (ec != std::errc() || ptr != sv.data() + sv.size())
+    {
+        return false;
+    }
+#else
+    // older libc++ (Apple) has no floating point from_chars
+    char buf[64] = {}; // NOLINT
+    if (sv.size() >= sizeof(buf))
+    {
+        return false;
+    }
+    memcpy(buf, sv.data(), sv.size());
+    char *end = nullptr;
+    v = strtod(buf, &end); // NOLINT
+    if (end != buf + sv.size()) // NOLINT
+    {
+        return false;
+    }
+#endif
+    out = v;
+    return true;
+}
+
+// Replaces several patterns at once, in a single pass over the text: the
+// output size is worked out first and the result written once, so there
+// is no shuffling of the tail per match. At each position the longest
+// pattern that matches wins (the first given, if two are the same
+// length); matches do not overlap, and replacement text is not rescanned.
+// A 256-entry table of first bytes lets most of the text be skipped a byte
+// at a time with no compare at all.
+//
+//  static const replacer xml{{"&", "&amp;"}, {"<", "&lt;"}, {">", "&gt;"}};
+//  std::string safe = xml(text);
+class replacer
+{
+  public:
+    using pair_type = std::pair<std::string_view, std::string_view>;
+
+    replacer(std::initializer_list<pair_type> pairs) : replacer(std::vector<pair_type>(pairs))
+    {
+    }
+    // empty search strings are ignored
+    explicit replacer(const std::vector<pair_type> &pairs)
+    {
+        for (const auto &p : pairs)
+        {
+            if (!p.first.empty())
+            {
+                m_patterns.push_back(pattern{std::string(p.first), std::string(p.second)});
+            }
+        }
+        // grouped by first byte, longest first; stable, so ties keep their order
+        std::stable_sort(m_patterns.begin(), m_patterns.end(), [](const pattern &a, const pattern &b) {
+            const auto fa = static_cast<unsigned char>(a.from[0]);
+            const auto fb = static_cast<unsigned char>(b.from[0]);
+            return fa != fb ? fa < fb : a.from.size() > b.from.size();
+        });
+        for (size_t i = 0; i < m_patterns.size(); ++i)
+        {
+            const auto u = static_cast<unsigned char>(m_patterns[i].from[0]);
+            if (m_count[u] == 0)
+            {
+                m_begin[u] = static_cast<uint32_t>(i); // NOLINT
+            }
+            ++m_count[u]; // NOLINT
+        }
+    }
+
+    // the length of s once replaced
+    size_t output_size(std::string_view s) const noexcept
+    {
+        size_t ret = 0;
+        scan(
+            s, [&ret](std::string_view t) { ret += t.size(); }, [&ret](const std::string &r) { ret += r.size(); });
+        return ret;
+    }
 
-    return (... + std::forward<Args>(args).size());
-    // const auto totalSize = (0 + ... + strings.length());
-}
+    // Writes s, replaced, to dest, which must have room for output_size(s)
+    // chars. Returns one past the last char written. Does not allocate.
+    char *replace_to(std::string_view s, char *dest) const noexcept
+    {
+        return replace_to(s, dest, 0);
+    }
 
-// efficient, straight concatenate with only one allocation.
-template <typename... Args> void cat(std::string &s, Args... args) // NOLINT
-{
+    // out = s, replaced. Returns the number of replacements. s may be (a
+    // view of) out itself.
+    size_t replace(std::string_view s, std::string &out) const
+    {
+        const size_t first = first_match(s);
+        if (first == std::string_view::npos)
+        {
+            out.assign(s.data(), s.size());
+            return 0;
+        }
+        if (detail::views_into(out, s))
+        {
+            // resizing out would overwrite (or free) s while it is scanned
+            std::string tmp;
+            const size_t n = replace(s, tmp, first);
+            out.swap(tmp);
+            return n;
+        }
+        return replace(s, out, first);
+    }
 
-    (s.append(args.data(), args.size()), ...);
-}
+    std::string operator()(std::string_view s) const
+    {
+        std::string ret;
+        replace(s, ret);
+        return ret;
+    }
 
-template <typename RESULT_TYPE>
-static inline std::vector<RESULT_TYPE> split2(const std::string_view haystack, const std::string_view needle = " ")
-{
-    std::vector<RESULT_TYPE> tokens;
-    const auto *it = haystack.begin(); // NOLINT
-    const auto *tok_it = it;
+    // replaces in s itself; returns the number of replacements. Does not
+    // allocate when there is nothing to replace.
+    size_t apply(std::string &s) const
+    {
+        const size_t first = first_match(s);
+        if (first == std::string::npos)
+        {
+            return 0;
+        }
+        std::string out;
+        const size_t n = replace(s, out, first);
+        s.swap(out);
+        return n;
+    }
 
-    while (it < haystack.end())
+  private:
+    struct pattern
     {
-        it = std::search(it, haystack.end(), needle.begin(), needle.end());
+        std::string from;
+        std::string to;
+    };
+    std::vector<pattern> m_patterns;
+    uint32_t m_begin[256] = {}; // first pattern starting with each byte // NOLINT
+    uint32_t m_count[256] = {}; // how many patterns start with it // NOLINT
 
-        if (tok_it == haystack.begin() && it == haystack.end())
+    const pattern *match(std::string_view s, size_t i) const noexcept
+    {
+        const auto u = static_cast<unsigned char>(s[i]);
+        const size_t left = s.size() - i;
+        for (uint32_t k = m_begin[u]; k < m_begin[u] + m_count[u]; ++k) // NOLINT
         {
-            return tokens; // nothing found
+            const auto &p = m_patterns[k];
+            if (p.from.size() <= left && memcmp(s.data() + i, p.from.data(), p.from.size()) == 0)
+            {
+                return &p;
+            }
         }
-        tokens.emplace_back(std::move(RESULT_TYPE(tok_it, it - tok_it)));
-        it += needle.size(); // NOLINT
-        tok_it = it;
+        return nullptr;
     }
-    return tokens;
-}
 
-template <typename RESULT_TYPE>
-static inline std::vector<RESULT_TYPE> split(std::string_view str, const std::string_view delimiters = " ")
-{
-    std::vector<RESULT_TYPE> tokens;
-    // Start at the beginning
-    std::string::size_type lastPos = 0;
-    // Find position of the first delimiter
-    std::string::size_type pos = str.find_first_of(delimiters, lastPos);
+    // where the first match starts, or npos
+    size_t first_match(std::string_view s) const noexcept
+    {
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            if (m_count[static_cast<unsigned char>(s[i])] != 0 && match(s, i) != nullptr) // NOLINT
+            {
+                return i;
+            }
+        }
+        return std::string_view::npos;
+    }
 
-    // While we still have string to read
-    while (std::string::npos != pos && std::string::npos != lastPos)
+    char *replace_to(std::string_view s, char *dest, size_t first) const noexcept
     {
-        // Found a token, add it to the vector
-        tokens.emplace_back(str.substr(lastPos, pos - lastPos));
-        // Look at the next token instead of skipping delimiters
-        lastPos = pos + delimiters.size();
-        // Find the position of the next delimiter
-        pos = str.find_first_of(delimiters, lastPos);
+        const auto put = [&dest](std::string_view t) {
+            if (!t.empty())
+            {
+                memcpy(dest, t.data(), t.size());
+                dest += t.size(); // NOLINT
+            }
+        };
+        scan(s, put, put, first);
+        return dest;
     }
 
-    // Push the last token
-    const auto sz = str.size() - lastPos; // NOLINT
-    if (sz && sz != std::string::npos)
+    // as replace(), with nothing to replace before first
+    size_t replace(std::string_view s, std::string &out, size_t first) const
     {
-        tokens.emplace_back(str.substr(lastPos, sz));
+        size_t size = 0;
+        const size_t n = scan(
+            s, [&size](std::string_view t) { size += t.size(); }, [&size](const std::string &r) { size += r.size(); },
+            first);
+        out.resize(size);
+        replace_to(s, out.data(), first);
+        return n;
     }
-    return tokens;
-}
 
-[[maybe_unused]] static inline int HHMMSSto_secs(std::string_view sdur)
-{
+    // text(run) for each unchanged run, repl(to) for each match; returns
+    // the number of matches. Matching starts at first, which must not be
+    // inside a match.
+    template <typename TEXT, typename REPL>
+    size_t scan(std::string_view s, TEXT &&text, REPL &&repl, size_t first = 0) const
+    {
+        size_t n = 0;
+        size_t run = 0;
+        size_t i = first;
+        while (i < s.size())
+        {
+            if (m_count[static_cast<unsigned char>(s[i])] == 0) // NOLINT
+            {
+                ++i;
+                continue;
+            }
+            const pattern *p = match(s, i);
+            if (p == nullptr)
+            {
+                ++i;
+                continue;
+            }
+            text(s.substr(run, i - run));
+            repl(p->to);
+            ++n;
+            i += p->from.size();
+            run = i;
+        }
+        text(s.substr(run));
+        return n;
+    }
+};
 
-    auto splut = split<std::string>(sdur, ":");
-    if (splut.empty())
+// returns the number of substitutions made. An empty search string
+// replaces nothing. Works in place (no allocation) unless replace is
+// longer than search, when the result is built once, at its final size.
+[[maybe_unused]] static inline size_t replace_all(std::string &subject, const std::string &search,
+                                                  const std::string &replace)
+{
+    if (search.empty())
     {
         return 0;
     }
-
-    int cur = 0;
-    int mults[] = {1, 60, 3600, 3600 * 24}; // NOLINT
-    int retval = 0;
-    for (const auto &s : splut) // NOLINT
+    size_t pos = subject.find(search);
+    if (pos == std::string::npos)
     {
-        const int mult_index = static_cast<int>(splut.size() - cur - 1); //-V104
-        assert(mult_index >= 0);
-        if (mult_index >= 4)
-        { //-V112
-            assert(0);
-            return -1;
+        return 0;
+    }
+    size_t n = 0;
+    if (replace.size() <= search.size())
+    {
+        // slide the text between matches down over the gaps
+        size_t w = pos;
+        while (pos != std::string::npos)
+        {
+            memcpy(subject.data() + w, replace.data(), replace.size());
+            w += replace.size();
+            const size_t from = pos + search.size();
+            pos = subject.find(search, from);
+            const size_t end = pos == std::string::npos ? subject.size() : pos;
+            memmove(subject.data() + w, subject.data() + from, end - from);
+            w += end - from;
+            ++n;
         }
-        int this_val = std::atol(s.c_str()); // NOLINT
-        this_val *= mults[mult_index];       // NOLINT
-        retval += this_val;
-        cur++;
+        subject.resize(w);
+        return n;
     }
 
-    return retval;
+    for (size_t p = pos; p != std::string::npos; p = subject.find(search, p + search.size()))
+    {
+        ++n;
+    }
+    std::string out;
+    out.reserve(subject.size() + n * (replace.size() - search.size()));
+    size_t from = 0;
+    for (size_t p = pos; p != std::string::npos; p = subject.find(search, from))
+    {
+        out.append(subject, from, p - from);
+        out += replace;
+        from = p + search.size();
+    }
+    out.append(subject, from, std::string::npos);
+    subject.swap(out);
+    return n;
 }
 
+// An empty search string replaces nothing.
 [[maybe_unused]] static inline std::string replace_all_copy(std::string subject, const std::string &search,
                                                             const std::string &replace)
 {
-
-    size_t pos = 0;
-    while ((pos = subject.find(search, pos)) != std::string::npos)
-    {
-        subject.replace(pos, search.length(), replace);
-        pos += replace.length();
-    }
+    replace_all(subject, search, replace);
     return subject;
 }
 
-// returns the number of substitutions made
-[[maybe_unused]] static inline size_t replace_all(std::string &subject, const std::string &search,
-                                                  const std::string &replace)
+namespace detail
 {
-    size_t pos = 0;
-    size_t retval = 0;
-    while ((pos = subject.find(search, pos)) != std::string::npos)
-    {
-        // std::string where = subject.substr(pos - 1);
-        subject.replace(pos, search.length(), replace);
-        ++retval;
-        pos += replace.length();
-    }
-    return retval;
+static inline const replacer &sql_escaper()
+{
+    static const replacer r{{"'", "''"}, {"\"", "\"\""}};
+    return r;
 }
+} // namespace detail
 
 // sanitize sql strings
 [[maybe_unused]] static inline void escape(std::string &s) // NOLINT
 {
-    replace_all(s, "'", "''");
-    replace_all(s, "\"", "\"\"");
+    detail::sql_escaper().apply(s);
 }
 // sanitize sql strings
 [[maybe_unused]] static inline std::string escape(std::string_view what)
 {
-    std::string s(what); // NOLINT
-    replace_all(s, "'", "''");
-    replace_all(s, "\"", "\"\"");
-    return s;
+    return detail::sql_escaper()(what);
+}
+
+// how long s will be once escape()d
+[[maybe_unused]] static inline size_t escaped_size(const std::string_view s) noexcept // NOLINT
+{
+    return detail::sql_escaper().output_size(s);
+}
+
+// escape() s straight into dest, which must have room for escaped_size(s)
+// chars. Returns one past the last char written. Does not allocate.
+[[maybe_unused]] static inline char *escape_to(const std::string_view s, char *dest) noexcept // NOLINT
+{
+    return detail::sql_escaper().replace_to(s, dest);
 }
 
 // sanitise sql strings, possibly more performant if you
 // hang on to out over multiple calls.
 [[maybe_unused]] static inline void escape(const std::string_view s, std::string &out) // NOLINT
 {
-    out = s;
-    replace_all(out, "'", "''");
-    replace_all(out, "\"", "\"\"");
+    detail::sql_escaper().replace(s, out);
 }
 
 template <typename N = std::string, typename V = std::string> struct name_value_pair
@@ -661,6 +1964,146 @@ using nvp_iterator = typename name_value_pairs_t<>::const_iterator;
     return ret;
 }
 
+// Keeps one copy of each distinct string, so that names repeated across
+// many rows or objects share storage. Each string gets a small id (0, 1,
+// 2, ... in order of first sight) and a view that stays valid for as long
+// as the interner lives: the bytes sit in fixed-size chunks that are never
+// moved or freed. Two interned views are the same string iff their data()
+// pointers are equal, so equality is a pointer (or id) compare.
+//
+// Thread-safe. Strings already interned are found under a shared lock;
+// only a string seen for the first time takes the exclusive one.
+//
+//  static string_interner names;
+//  const auto artist = names.intern(row[0]); // stable; compare by .data()
+template <typename HASH = std::hash<std::string_view>, typename EQUAL = std::equal_to<std::string_view>>
+class basic_string_interner
+{
+  public:
+    using id_type = uint32_t;
+    static constexpr id_type invalid_id = ~id_type{0};
+
+    explicit basic_string_interner(size_t chunk_size = 64 * 1024) : m_chunk_size(chunk_size != 0 ? chunk_size : 1)
+    {
+    }
+    basic_string_interner(const basic_string_interner &) = delete;
+    basic_string_interner &operator=(const basic_string_interner &) = delete;
+
+    // s's id, adding s if it is new
+    id_type intern_id(std::string_view s)
+    {
+        return add(s).first;
+    }
+    // the interned copy of s, adding s if it is new
+    std::string_view intern(std::string_view s)
+    {
+        return add(s).second;
+    }
+
+    // s's id, or invalid_id if it has never been interned
+    id_type find(std::string_view s) const
+    {
+        std::shared_lock lock(m_mutex);
+        const auto it = m_ids.find(s);
+        return it == m_ids.end() ? invalid_id : it->second;
+    }
+    bool contains(std::string_view s) const
+    {
+        return find(s) != invalid_id;
+    }
+
+    // the string with this id, which must be one returned by this interner
+    std::string_view view(id_type id) const
+    {
+        std::shared_lock lock(m_mutex);
+        assert(id < m_views.size());
+        return m_views[id];
+    }
+
+    // number of distinct strings
+    size_t size() const
+    {
+        std::shared_lock lock(m_mutex);
+        return m_views.size();
+    }
+    // bytes of string data held (not counting the index)
+    size_t bytes() const
+    {
+        std::shared_lock lock(m_mutex);
+        return m_bytes;
+    }
+
+  private:
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::string_view, id_type, HASH, EQUAL> m_ids; // keys point into m_chunks
+    std::vector<std::string_view> m_views; // by id
+    std::vector<std::unique_ptr<char[]>> m_chunks; // NOLINT
+    size_t m_chunk_size;
+    char *m_chunk = nullptr; // the one small strings go in
+    size_t m_chunk_left = 0;
+    size_t m_bytes = 0;
+
+    std::pair<id_type, std::string_view> add(std::string_view s)
+    {
+        {
+            std::shared_lock lock(m_mutex);
+            const auto it = m_ids.find(s);
+            if (it != m_ids.end())
+            {
+                return {it->second, it->first};
+            }
+        }
+        std::unique_lock lock(m_mutex);
+        // someone may have added it between the locks
+        const auto it = m_ids.find(s);
+        if (it != m_ids.end())
+        {
+            return {it->second, it->first};
+        }
+        MYASSERT(m_views.size() < invalid_id, "string_interner: out of ids"); // NOLINT
+        const std::string_view stored(store(s), s.size());
+        const auto id = static_cast<id_type>(m_views.size());
+        m_views.push_back(stored);
+        m_ids.emplace(stored, id);
+        return {id, stored};
+    }
+
+    // copies s into the arena; the bytes never move
+    const char *store(std::string_view s)
+    {
+        if (s.empty())
+        {
+            // takes no room, so it would share its data() with whatever
+            // came next: give it an address of its own
+            static const char empty = '\0';
+            return &empty;
+        }
+        m_bytes += s.size();
+        if (s.size() > m_chunk_size / 4)
+        {
+            // big: a chunk of its own, so the current one isn't wasted
+            m_chunks.push_back(std::make_unique<char[]>(s.size())); // NOLINT
+            memcpy(m_chunks.back().get(), s.data(), s.size());
+            return m_chunks.back().get();
+        }
+        if (m_chunk == nullptr || s.size() > m_chunk_left)
+        {
+            m_chunks.push_back(std::make_unique<char[]>(m_chunk_size)); // NOLINT
+            m_chunk = m_chunks.back().get();
+            m_chunk_left = m_chunk_size;
+        }
+        char *p = m_chunk + (m_chunk_size - m_chunk_left); // NOLINT
+        memcpy(p, s.data(), s.size());
+        m_chunk_left -= s.size();
+        return p;
+    }
+};
+
+using string_interner = basic_string_interner<>;
+// as string_interner, but "Artist" and "ARTIST" are one string (the first
+// one seen)
+using string_interner_ci = basic_string_interner<string_hash_transparent_ci, ci_equal_to<>>;
+
 } // namespace strings
 
 template <typename T>
@@ -992,7 +2435,7 @@ int test_case()
     return 0;
 }
 
-static inline test_sv_trim()
+static inline int test_sv_trim()
 {
     constexpr auto a = "Hello";
     constexpr auto aa = " Hello";
@@ -1015,6 +2458,7 @@ static inline test_sv_trim()
     assert(cc == "Hello");
     const auto ddd = my::utils::strings::ltrim(aaa);
     assert(ddd == "Hello");
+    return 0;
 }
 
 static inline int test_more()
@@ -1030,9 +2474,75 @@ static inline int test_more()
     assert(s == "Thetimeisnow");
     s = utils::strings::concat(42, 41.2, "hi");
     assert(s == "4241.2hi");
+    s = utils::strings::concat('c', -7, 3.0, 1e20, true, 0.1f, std::string_view("sv"), 18446744073709551615ULL);
+    assert(s == "c-731e+201" "0.1sv18446744073709551615");
+    {
+        std::stringstream ss;
+        ss << 'c' << -7 << 3.0 << 1e20 << true << 0.1f << "sv" << 18446744073709551615ULL;
+        assert(ss.str() == s);
+    }
+    s = "x=";
+    utils::strings::concat_append(s, 1.5, ", ", std::vector<int>().size());
+    assert(s == "x=1.5, 0");
+    assert(utils::strings::concat().empty());
+    {
+        // appending a string to itself
+        std::string self = "abcdefghijklmnopqrstuvwxyz";
+        utils::strings::cat(self, self);
+        assert(self == "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+        self = "0123456789ABCDEFGHIJ";
+        utils::strings::cat(self, "x", self);
+        assert(self == "0123456789ABCDEFGHIJx0123456789ABCDEFGHIJ");
+        self = "0123456789ABCDEFGHIJ";
+        utils::strings::concat_append(self, std::string_view(self).substr(10), 1);
+        assert(self == "0123456789ABCDEFGHIJABCDEFGHIJ1");
+    }
+    utils::strings::cat(s, '!', 2);
+    assert(s == "x=1.5, 0!2");
 
     s = utils::strings::random_string(32);
     assert(s.size() == 32);
+    assert(utils::strings::random_string(8, 7) == utils::strings::random_string(8, 7));
+    {
+        const auto a = utils::strings::random_strings::ranged(1000, 5, 20, 42);
+        const auto b = utils::strings::random_strings::ranged(1000, 5, 20, 42);
+        assert(a.size() == 1000 && a.views() == b.views());
+        // the lengths really do vary, over the whole range
+        size_t shortest = 100;
+        size_t longest = 0;
+        for (const auto v : utils::strings::random_strings::ranged(1000, 3, 12))
+        {
+            shortest = (std::min)(shortest, v.size());
+            longest = (std::max)(longest, v.size());
+        }
+        assert(shortest == 3 && longest == 12);
+        for (const auto v : a)
+        {
+            assert(v.size() >= 5 && v.size() <= 20 && v.data()[v.size()] == '\0');
+            for (const char c : v)
+            {
+                assert(isalnum(static_cast<unsigned char>(c)));
+            }
+        }
+        const utils::strings::random_strings c(1000, 16, 43);
+        assert(c[0].size() == 16 && c[0] != a[0] && c.views() != utils::strings::random_strings(1000, 16, 44).views());
+
+        // moved, big or small, the views still point into the text
+        static_assert(!std::is_copy_constructible_v<utils::strings::random_strings>);
+        for (const size_t n : {size_t{1}, size_t{1000}})
+        {
+            utils::strings::random_strings from(n, 3);
+            const std::vector<std::string> want(from.begin(), from.end());
+            utils::strings::random_strings moved(std::move(from));
+            assert(from.empty() && moved.size() == n); // NOLINT
+            utils::strings::random_strings assigned(1, 1);
+            assigned = std::move(moved);
+            for (size_t i = 0; i < n; ++i)
+            {
+                assert(assigned[i] == want[i] && assigned[i].data()[assigned[i].size()] == '\0');
+            }
+        }
+    }
     std::string s2 = utils::strings::random_string(32);
     assert(s2 != s);
     s2 += "\t:;!<>£";
@@ -1063,6 +2573,350 @@ static inline int test_map()
     map3.insert(map.begin(), map.end());
     map3.insert(map2.begin(), map2.end());
     assert(map3.size() == 1);
+    return 0;
+}
+
+static inline int test_escape()
+{
+    using namespace utils::strings;
+    const std::string_view raw{"It's \"fine\""};
+    const std::string expect = escape(raw);
+    assert(expect == "It''s \"\"fine\"\"");
+    assert(escaped_size(raw) == expect.size());
+    std::string out(escaped_size(raw), '\0');
+    const char *end = escape_to(raw, out.data());
+    assert(end == out.data() + out.size());
+    assert(out == expect);
+    assert(escaped_size("") == 0);
+    return 0;
+}
+
+static inline int test_parse_numbers()
+{
+    using namespace utils::strings;
+    int64_t i = -1;
+    assert(parse_int64("42", i) && i == 42);
+    assert(parse_int64(" -17 ", i) && i == -17);
+    assert(parse_int64("+9", i) && i == 9);
+    assert(!parse_int64("", i));
+    assert(!parse_int64("12a", i));
+    assert(!parse_int64("+-3", i));
+    assert(!parse_int64("99999999999999999999", i));
+    assert(i == 9);
+
+    double d = 0;
+    assert(parse_double("41.25", d) && d == 41.25);
+    assert(parse_double("-3", d) && d == -3.0);
+    assert(parse_double("1e3", d) && d == 1000.0);
+    assert(!parse_double("1.5x", d));
+    assert(!parse_double("+-3", d));
+    assert(parse_double("+3", d) && d == 3.0);
+    assert(!parse_double(" ", d));
+    return 0;
+}
+
+static inline int test_ci_hash()
+{
+    using namespace utils::strings;
+    // the SWAR fold agrees with the per-byte one, for every byte in every lane
+    for (unsigned c = 0; c < 256; ++c)
+    {
+        for (unsigned lane = 0; lane < 8; ++lane)
+        {
+            const uint64_t spaces = 0x2020202020202020ULL & ~(uint64_t{0xff} << (lane * 8U));
+            const uint64_t w = (uint64_t{c} << (lane * 8U)) | spaces;
+            const uint64_t up = detail::swar_to_upper(w);
+            const uint64_t lo = detail::swar_to_lower(w);
+            const auto expect_up = static_cast<unsigned char>((c - 'a' < 26U) ? c - 32U : c);
+            const auto expect_lo = static_cast<unsigned char>((c - 'A' < 26U) ? c + 32U : c);
+            assert(((up >> (lane * 8U)) & 0xffU) == expect_up);
+            assert(((lo >> (lane * 8U)) & 0xffU) == expect_lo);
+        }
+    }
+
+    std::string s;
+    for (size_t len = 0; len < 40; ++len)
+    {
+        std::string upper = to_upper(s);
+        assert(ci_hash(s) == ci_hash(upper));
+        std::string other = s + "x";
+        assert(ci_hash(s) != ci_hash(other));
+        s += static_cast<char>('a' + len % 26);
+    }
+    assert(ci_hash("Hello, World") == ci_hash("hELLO, wORLD"));
+    assert(ci_hash("\xe9t\xe9") != ci_hash("\xc9t\xc9")); // only ASCII folds
+    assert(ci_hash("ab") != ci_hash(std::string_view("ab\0", 3)));
+
+    const string_hash_transparent_ci h;
+    assert(h("Abba") == h(std::string("aBBA")));
+    return 0;
+}
+
+static inline int test_case_kernels()
+{
+    using namespace utils::strings;
+    // every byte value, at every offset and length the kernels split on
+    std::string all;
+    for (int rep = 0; rep < 3; ++rep)
+    {
+        for (int c = 0; c < 256; ++c)
+        {
+            all += static_cast<char>(c);
+        }
+    }
+    for (size_t off = 0; off < 40; off += 3)
+    {
+        for (size_t len = 0; off + len <= all.size(); len += 7)
+        {
+            const std::string in = all.substr(off, len);
+            std::string up = in;
+            std::string lo = in;
+            std::string fl = in;
+            make_upper(up);
+            make_lower(lo);
+            make_flipped(fl);
+            for (size_t i = 0; i < in.size(); ++i)
+            {
+                const auto c = static_cast<unsigned char>(in[i]);
+                const bool lower = c - unsigned{'a'} < 26U;
+                const bool upper = c - unsigned{'A'} < 26U;
+                assert(static_cast<unsigned char>(up[i]) == (lower ? c - 32U : c));
+                assert(static_cast<unsigned char>(lo[i]) == (upper ? c + 32U : c));
+                assert(static_cast<unsigned char>(fl[i]) == (lower ? c - 32U : upper ? c + 32U : c));
+            }
+            assert(is_ascii(in) == (std::find_if(in.begin(), in.end(), [](char ch) {
+                                        return static_cast<unsigned char>(ch) >= 0x80U;
+                                    }) == in.end()));
+        }
+    }
+    assert(is_ascii(""));
+    assert(is_ascii("plain old text, long enough for a vector or two"));
+    assert(!is_ascii("plain old text, long enough for a vector or tw\xc3\xb6"));
+    return 0;
+}
+
+static inline int test_ci_compare()
+{
+    using namespace utils::strings;
+    const auto reference = [](std::string_view a, std::string_view b) {
+        std::string la(a);
+        std::string lb(b);
+        make_lower(la);
+        make_lower(lb);
+        const int r = la.compare(lb); // char_traits<char> compares as unsigned
+        return r < 0 ? -1 : (r > 0 ? 1 : 0);
+    };
+    const auto sign = [](int r) { return r < 0 ? -1 : (r > 0 ? 1 : 0); };
+
+    std::mt19937 gen(7);
+    const std::string alphabet = "aAbBzZ_@[`{\xe9\xc9 09";
+    for (int iter = 0; iter < 20000; ++iter)
+    {
+        const size_t len = gen() % 40;
+        std::string a;
+        for (size_t i = 0; i < len; ++i)
+        {
+            a += alphabet[gen() % alphabet.size()];
+        }
+        std::string b = a;
+        flip_case_branchless(b);
+        assert(ci_equal(a, b));
+        assert(ci_compare(a, b) == 0);
+        if (!b.empty() && gen() % 2)
+        {
+            b[gen() % b.size()] = alphabet[gen() % alphabet.size()];
+        }
+        else if (gen() % 2)
+        {
+            b.resize(gen() % (b.size() + 1));
+        }
+        assert(sign(ci_compare(a, b)) == reference(a, b));
+        assert(ci_equal(a, b) == (reference(a, b) == 0));
+        assert(compare_less_nocase(a, b) == (reference(a, b) < 0));
+    }
+    assert(compare_less_nocase("_", "a"));  // lower-case ordering
+    assert(!compare_less_nocase("a", "A"));
+    assert(ci_less_lib_c()(std::string("abba"), std::string("ABBC")));
+    assert(ci_equal_to<>()(std::string("Dancing Queen"), "dANCING qUEEN"));
+    return 0;
+}
+
+static inline int test_split_view()
+{
+    using namespace utils::strings;
+    const auto tokens = [](std::string_view s, std::string_view d, split_mode m = split_mode::sequence) {
+        std::vector<std::string> ret;
+        for (const auto t : split_view(s, d, m))
+        {
+            ret.emplace_back(t);
+        }
+        return ret;
+    };
+    using v = std::vector<std::string>;
+    assert(tokens("a\tb\t\tc", "\t") == (v{"a", "b", "", "c"}));
+    assert(tokens("a\tb\t", "\t") == (v{"a", "b", ""}));
+    assert(tokens("", "\t") == (v{""}));
+    assert(tokens("abc", "") == (v{"abc"}));
+    assert(tokens("a\r\nb\nc\r\n", "\r\n") == (v{"a", "b\nc", ""}));
+    assert(tokens("a\r\nb\nc", "\r\n", split_mode::any_of) == (v{"a", "", "b", "c"}));
+    assert(tokens("x::y:::z", "::") == (v{"x", "y", ":z"}));
+    assert(tokens("1:2;3", ":;", split_mode::any_of) == (v{"1", "2", "3"}));
+
+    std::vector<std::string_view> out;
+    split_into(out, "one two three", " ");
+    assert(out.size() == 3 && out[2] == "three");
+    const auto *before = out.data();
+    assert(split_into(out, "four five", " ") == 2);
+    assert(out.data() == before && out[0] == "four");
+
+    // legacy behaviour, unchanged
+    assert(split<std::string>("a b ", " ").size() == 2);
+    assert(split2<std::string>("abc", ",").empty());
+
+    assert(HHMMSSto_secs("3:11") == 191);
+    assert(HHMMSSto_secs("1:00:00") == 3600);
+    assert(HHMMSSto_secs("1:0:0:5") == 24 * 3600 + 5);
+    assert(HHMMSSto_secs("") == 0);
+    assert(HHMMSSto_secs("45") == 45);
+    assert(HHMMSSto_secs("3:") == 3);
+    return 0;
+}
+
+static inline int test_parse_duration()
+{
+    using namespace utils::strings;
+    int32_t secs = -1;
+    double dsecs = 0;
+    assert(parse_duration("03:11", secs) && secs == 191);
+    assert(parse_duration(" 1:02:03 ", secs) && secs == 3723);
+    assert(parse_duration("2:01:02:03", secs) && secs == 2 * 86400 + 3723);
+    assert(parse_duration("45", secs) && secs == 45);
+    assert(parse_duration("3:11.5", dsecs) && dsecs == 191.5);
+    assert(parse_duration("0.25", dsecs) && dsecs == 0.25);
+    secs = -1;
+    assert(!parse_duration("", secs) && secs == -1);
+    assert(!parse_duration("3:", secs));
+    assert(!parse_duration(":3", secs));
+    assert(!parse_duration("3:60", secs));
+    assert(!parse_duration("03:6x", secs));
+    assert(!parse_duration("1:24:00:00", secs));
+    assert(!parse_duration("1:2:3:4:5", secs));
+    assert(!parse_duration("3.5:00", secs));
+    assert(!parse_duration("3:1.", secs));
+    assert(!parse_duration("-3:10", secs));
+    assert(!parse_duration("99999999999", secs));
+
+    const std::vector<std::string_view> col{"03:11", "59:59", "", "1:00:00", "bad", "7:5x"};
+    std::vector<int32_t> out;
+    assert(parse_durations(col, out) == 2);
+    assert((out == std::vector<int32_t>{191, 3599, 0, 3600, 0, 0}));
+
+    // malformed input still gets the old lenient reading
+    assert(HHMMSSto_secs("1:75") == 135);
+    assert(HHMMSSto_secs("3:11.9") == 191);
+    return 0;
+}
+
+static inline int test_interner()
+{
+    using namespace utils::strings;
+    string_interner names(16);
+    const std::string a = "Abba";
+    const auto va = names.intern(a);
+    assert(va == "Abba" && va.data() != a.data());
+    assert(names.intern(std::string("Abba")).data() == va.data());
+    assert(names.intern_id("Blur") == 1 && names.intern_id("Abba") == 0);
+    assert(names.find("Blur") == 1 && names.find("Oasis") == string_interner::invalid_id);
+    assert(names.view(1) == "Blur");
+
+    // longer than a chunk: stored apart, the earlier views unharmed
+    const std::string longer(100, 'x');
+    const auto vl = names.intern(longer);
+    assert(vl == longer && names.intern(longer).data() == vl.data());
+    for (int i = 0; i < 100; ++i)
+    {
+        names.intern(std::to_string(i));
+    }
+    assert(va == "Abba" && names.view(0).data() == va.data());
+    assert(names.size() == 103);
+    assert(names.intern("") == "" && names.size() == 104);
+
+    // the empty string first: the next string must not share its data()
+    string_interner fresh(16);
+    const auto empty = fresh.intern("");
+    const auto x = fresh.intern("x");
+    assert(empty.empty() && x == "x" && empty.data() != x.data());
+    assert(fresh.intern("").data() == empty.data() && fresh.intern_id("") == 0);
+    assert(fresh.intern_id("x") == 1 && fresh.size() == 2 && fresh.bytes() == 1);
+
+    string_interner_ci ci;
+    const auto first = ci.intern("Gender");
+    assert(ci.intern("GENDER").data() == first.data() && first == "Gender");
+    assert(ci.size() == 1 && ci.bytes() == 6);
+    return 0;
+}
+
+static inline int test_replacer()
+{
+    using namespace utils::strings;
+    const replacer xml{{"&", "&amp;"}, {"<", "&lt;"}, {">", "&gt;"}, {"<<", "&laquo;"}};
+    assert(xml("a < b && c >> d <<e") == "a &lt; b &amp;&amp; c &gt;&gt; d &laquo;e");
+    assert(xml("") == "");
+    assert(xml("nothing to do") == "nothing to do");
+    const std::string in = "<<<";
+    assert(xml.output_size(in) == xml(in).size());
+    std::string out;
+    assert(xml.replace(in, out) == 2 && out == "&laquo;&lt;");
+
+    // replacement text is not rescanned, and matches don't overlap
+    const replacer r{{"aa", "a"}, {"b", "bb"}};
+    assert(r("aaaab") == "aabb");
+
+    std::string s = "a.b.c";
+    assert(replace_all(s, ".", "::") == 2 && s == "a::b::c");
+    assert(replace_all(s, "", "x") == 0 && s == "a::b::c");
+    assert(replace_all_copy(s, "::", "") == "abc");
+    s = "aaaaa";
+    assert(replace_all(s, "aa", "b") == 2 && s == "bba");
+    s = "xaxax";
+    assert(replace_all(s, "x", "yz") == 3 && s == "yzayzayz");
+    assert(replace_all(s, "yz", "12") == 3 && s == "12a12a12");
+    assert(replace_all(s, "12", "") == 3 && s == "aa");
+
+    // nothing to replace: s is left alone, and nothing is allocated
+    s = std::string(100, 'q');
+    const char *before = s.data();
+    assert(replace_all(s, "z", "zz") == 0 && xml.apply(s) == 0 && s.data() == before);
+    std::string shrunk = "one, two, three, " + s;
+    before = shrunk.data();
+    assert(replace_all(shrunk, ", ", ",") == 3 && shrunk.data() == before);
+    assert(shrunk == "one,two,three," + s);
+    std::string plain = "no quotes at all, but long enough not to be small";
+    before = plain.data();
+    escape(plain);
+    assert(plain.data() == before);
+    out.clear();
+    assert(xml.replace("plain", out) == 0 && out == "plain");
+    assert(r.apply(s) == 0);
+    s = "xyzaa";
+    assert(r.apply(s) == 1 && s == "xyza");
+
+    std::string q = "it's \"q\"";
+    escape(q);
+    assert(q == "it''s \"\"q\"\"");
+    escape(std::string_view("'"), out);
+    assert(out == "''");
+
+    // input that is (part of) the output
+    std::string self = "a'b'c, and long enough to be on the heap";
+    escape(self, self);
+    assert(self == "a''b''c, and long enough to be on the heap");
+    self = "<tail of a long string, to be on the heap>";
+    assert(xml.replace(std::string_view(self).substr(1), self) == 1);
+    assert(self == "tail of a long string, to be on the heap&gt;");
+    self = "no match";
+    assert(xml.replace(std::string_view(self).substr(3), self) == 0 && self == "match");
+    return 0;
 }
 
 static inline int run_all_tests()
@@ -1089,6 +2943,42 @@ static inline int run_all_tests()
     {
         throw std::runtime_error("map unique test failed.");
     }
+    if (test_escape())
+    {
+        throw std::runtime_error("test_escape() failed.");
+    }
+    if (test_parse_numbers())
+    {
+        throw std::runtime_error("test_parse_numbers() failed.");
+    }
+    if (test_ci_hash())
+    {
+        throw std::runtime_error("test_ci_hash() failed.");
+    }
+    if (test_case_kernels())
+    {
+        throw std::runtime_error("test_case_kernels() failed.");
+    }
+    if (test_ci_compare())
+    {
+        throw std::runtime_error("test_ci_compare() failed.");
+    }
+    if (test_split_view())
+    {
+        throw std::runtime_error("test_split_view() failed.");
+    }
+    if (test_parse_duration())
+    {
+        throw std::runtime_error("test_parse_duration() failed.");
+    }
+    if (test_interner())
+    {
+        throw std::runtime_error("test_interner() failed.");
+    }
+    if (test_replacer())
+    {
+        throw std::runtime_error("test_replacer() failed.");
+    }
     puts("All utils tests completed successfully.\n");
     fflush(stdout);
     return 0;
@@ -7,11 +7,25 @@
 #include <vector>
 #include <unordered_map>
 #include <map>
+#include <list>
 #include <optional>
 #include <iostream>
 #include <algorithm>
 #include <cstring>
-#include "../utils/utils.hpp"
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "my_utils.hpp"
 
 struct sqlite {
 
@@ -33,8 +47,8 @@ struct sqlite {
     using column_type = column_t;
 
     using columns_type = std::unordered_map<std::string, column_t,
-        utils::strings::string_hash_transparent_ci,
-        utils::strings::transparent_string_ci_equal<>>;
+        my::utils::strings::string_hash_transparent_ci,
+        my::utils::strings::ci_equal_to<>>;
     columns_type m_columns;
 
     const columns_type& columns() const noexcept { return m_columns; }
@@ -93,35 +107,56 @@ struct sqlite {
     }
 
     private:
-    static void errorLogCallback(void* pArg, int iErrCode, const char* zMsg) {
-        sqlite* pthis = (sqlite*)pArg;
-        if (zMsg) {
-            pthis->m_slasterror = zMsg;
+    // sqlite's log is process-wide (SQLITE_CONFIG_LOG), so it can't know
+    // which connection it is talking about. Each connection reads its own
+    // errors from its handle instead (record_error(), set_last_error());
+    // this only echoes the log to stderr when global_log_to_stderr(true).
+    static std::atomic<bool>& global_log_flag() noexcept {
+        static std::atomic<bool> flag{false};
+        return flag;
+    }
+    static void global_log_callback(void*, int iErrCode, const char* zMsg) {
+        if (global_log_flag().load(std::memory_order_relaxed)) {
+            fprintf(stderr, "sqlite log, (%d) %s\n", iErrCode,
+                zMsg ? zMsg : "");
         }
-        pthis->m_lasterror = iErrCode;
-        if (pthis->errors_to_stderr())
-            fprintf(stderr, "C++ sqlite error, (%d) %s\n", iErrCode, zMsg);
+    }
+    static void register_global_log() noexcept {
+        static std::once_flag once;
+        std::call_once(once, [] {
+            // fails (harmlessly) if sqlite was initialised before we got
+            // here, e.g. by some other user of the library
+            sqlite3_config(SQLITE_CONFIG_LOG, global_log_callback, nullptr);
+        });
     }
     enum class modes { none, getting_row_count, selecting, inserting };
 
     modes m_mode{modes::none};
-    size_t m_row_count;
+    size_t m_row_count{0};
 
     public:
-    sqlite(std::string_view filepath) {
-        int x = sqlite3_config(SQLITE_CONFIG_LOG, errorLogCallback, this);
-        assert(x == SQLITE_OK);
-        (void)x;
+    explicit sqlite(std::string_view filepath)
+        : sqlite(filepath, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) {}
 
-        m_lasterror = sqlite3_open(filepath.data(), &m_handle);
+    // flags as for sqlite3_open_v2(), e.g. SQLITE_OPEN_READONLY |
+    // SQLITE_OPEN_NOMUTEX for a connection only ever used by one thread
+    // at a time.
+    sqlite(std::string_view filepath, int flags, const char* vfs = nullptr) {
+        register_global_log();
+        const std::string path(filepath);
+        m_lasterror = sqlite3_open_v2(path.c_str(), &m_handle, flags, vfs);
         if (m_lasterror == SQLITE_OK) {
-            m_path = filepath;
-
+            m_path = path;
         } else {
-            throw std::runtime_error(sqlite3_errstr(m_lasterror));
+            std::string msg = m_handle ? sqlite3_errmsg(m_handle)
+                                       : sqlite3_errstr(m_lasterror);
+            sqlite3_close(m_handle);
+            m_handle = nullptr;
+            throw std::runtime_error(msg);
         }
     }
     ~sqlite() {
+        clear_statement_cache(); // must be finalized before the close
         if (m_handle) {
             sqlite3_close(m_handle);
             m_handle = nullptr;
@@ -131,6 +166,21 @@ struct sqlite {
     sqlite& operator=(const sqlite&) = delete;
     bool errors_to_stderr() const noexcept { return m_errs_to_stderr; }
     void errors_to_stderr(bool b) { m_errs_to_stderr = b; }
+    static void global_log_to_stderr(bool b) noexcept {
+        global_log_flag().store(b, std::memory_order_relaxed);
+    }
+    sqlite3* handle() const noexcept { return m_handle; }
+
+    // Write-ahead logging: readers no longer block the writer (or each
+    // other). The mode is stored in the database file.
+    int set_wal_mode() {
+        return record_error(sqlite3_exec(m_handle,
+            "PRAGMA journal_mode=WAL", nullptr, nullptr, nullptr));
+    }
+    // how long to retry on SQLITE_BUSY before giving up
+    int set_busy_timeout(int ms) {
+        return record_error(sqlite3_busy_timeout(m_handle, ms));
+    }
     const std::string& path() const noexcept { return m_path; }
     static std::string_view error_string(int errcode) noexcept {
         return sqlite3_errstr(errcode);
@@ -139,13 +189,666 @@ struct sqlite {
         return m_slasterror;
     }
     int last_error_code() const noexcept { return m_lasterror; }
+    // Makes rc, from a sqlite3_* call on handle(), the last error (the
+    // message comes from the handle). Returns rc.
+    int record_error(int rc) {
+        m_lasterror = rc;
+        if (rc == SQLITE_OK || rc == SQLITE_ROW || rc == SQLITE_DONE) {
+            m_slasterror.clear();
+        } else {
+            m_slasterror = sqlite3_errmsg(m_handle);
+            report_error();
+        }
+        return rc;
+    }
     static bool string_contains(
         std::string_view haystack, std::string_view needle) {
         return haystack.find(needle) >= 0;
     }
 
+    // A prepared statement, finalized on destruction. Parameters are
+    // 1-based, as in sqlite; step() returns SQLITE_ROW, SQLITE_DONE or an
+    // error code.
+    class statement {
+        sqlite3_stmt* m_stmt = nullptr;
+
+        public:
+        statement() = default;
+        explicit statement(sqlite3_stmt* stmt) noexcept : m_stmt(stmt) {}
+        ~statement() { finalize(); }
+        statement(const statement&) = delete;
+        statement& operator=(const statement&) = delete;
+        statement(statement&& rhs) noexcept : m_stmt(rhs.m_stmt) {
+            rhs.m_stmt = nullptr;
+        }
+        statement& operator=(statement&& rhs) noexcept {
+            if (this != &rhs) {
+                finalize();
+                m_stmt = rhs.m_stmt;
+                rhs.m_stmt = nullptr;
+            }
+            return *this;
+        }
+
+        explicit operator bool() const noexcept { return m_stmt != nullptr; }
+        sqlite3_stmt* handle() const noexcept { return m_stmt; }
+        void finalize() noexcept {
+            if (m_stmt) {
+                sqlite3_finalize(m_stmt);
+                m_stmt = nullptr;
+            }
+        }
+        int parameter_count() const noexcept {
+            return sqlite3_bind_parameter_count(m_stmt);
+        }
+        // 0 if there is no parameter with that name (":id", "@id", ...)
+        int parameter_index(const char* name) const noexcept {
+            return sqlite3_bind_parameter_index(m_stmt, name);
+        }
+
+        int bind(int i, std::nullptr_t) noexcept {
+            return sqlite3_bind_null(m_stmt, i);
+        }
+        template <typename T,
+            std::enable_if_t<std::is_integral_v<T>, int> = 0>
+        int bind(int i, T v) noexcept {
+            return sqlite3_bind_int64(m_stmt, i, static_cast<sqlite3_int64>(v));
+        }
+        int bind(int i, double v) noexcept {
+            return sqlite3_bind_double(m_stmt, i, v);
+        }
+        // sqlite takes a copy of the text, so temporaries are fine here.
+        int bind(int i, std::string_view v) noexcept {
+            return sqlite3_bind_text(m_stmt, i, v.data(),
+                static_cast<int>(v.size()), SQLITE_TRANSIENT);
+        }
+        // No copy: v must stay valid until the next step() or reset().
+        int bind_static(int i, std::string_view v) noexcept {
+            return sqlite3_bind_text(m_stmt, i, v.data(),
+                static_cast<int>(v.size()), SQLITE_STATIC);
+        }
+        int bind_blob(
+            int i, const void* p, size_t n, bool copy = true) noexcept {
+            return sqlite3_bind_blob(m_stmt, i, p, static_cast<int>(n),
+                copy ? SQLITE_TRANSIENT : SQLITE_STATIC);
+        }
+        // binds args to parameters 1, 2, 3 ...; stops at the first error
+        template <typename... ARGS> int bind_all(const ARGS&... args) {
+            int i = 0;
+            int rc = SQLITE_OK;
+            ((rc = (rc == SQLITE_OK ? bind(++i, args) : rc)), ...);
+            return rc;
+        }
+
+        int step() noexcept { return sqlite3_step(m_stmt); }
+        // ready to step() again; bound values are kept
+        int reset() noexcept { return sqlite3_reset(m_stmt); }
+        int clear_bindings() noexcept { return sqlite3_clear_bindings(m_stmt); }
+    };
+
+    // BEGINs on construction, and rolls back on destruction unless
+    // commit() succeeded. A COMMIT that fails with SQLITE_BUSY (or
+    // SQLITE_LOCKED) leaves the transaction open: commit() again, or let
+    // it roll back.
+    //
+    // Inside a transaction that is already open (someone else's BEGIN, or
+    // an outer transaction object) this is a SAVEPOINT instead: commit()
+    // releases it into the outer transaction, which still decides whether
+    // it sticks, and rolling back undoes only what was done since.
+    class transaction {
+        sqlite* m_db = nullptr;
+        bool m_active = false;
+        bool m_nested = false;
+
+        int run(const char* sql) noexcept {
+            return sqlite3_exec(m_db->m_handle, sql, nullptr, nullptr, nullptr);
+        }
+
+        public:
+        explicit transaction(sqlite& db, bool immediate = true)
+            : m_db(&db), m_nested(sqlite3_get_autocommit(db.m_handle) == 0) {
+            const char* sql = m_nested ? "SAVEPOINT nested_transaction"
+                : immediate            ? "BEGIN IMMEDIATE"
+                                       : "BEGIN";
+            m_active = db.record_error(run(sql)) == SQLITE_OK;
+        }
+        ~transaction() {
+            // not through record_error(): keep whatever error got us here
+            if (m_active) run(rollback_sql());
+        }
+        transaction(const transaction&) = delete;
+        transaction& operator=(const transaction&) = delete;
+
+        bool active() const noexcept { return m_active; }
+        // true if this is a savepoint inside an outer transaction
+        bool nested() const noexcept { return m_nested; }
+        int commit() {
+            if (!m_active) return SQLITE_MISUSE;
+            const int rc = m_db->record_error(
+                run(m_nested ? "RELEASE nested_transaction" : "COMMIT"));
+            // some errors roll the transaction back for us; others don't
+            m_active = rc != SQLITE_OK
+                && sqlite3_get_autocommit(m_db->m_handle) == 0;
+            return rc;
+        }
+        int rollback() {
+            if (!m_active) return SQLITE_MISUSE;
+            m_active = false;
+            return m_db->record_error(run(rollback_sql()));
+        }
+
+        private:
+        const char* rollback_sql() const noexcept {
+            return m_nested ? "ROLLBACK TO nested_transaction; "
+                              "RELEASE nested_transaction"
+                            : "ROLLBACK";
+        }
+    };
+
+    // Compiles sql; check the result with operator bool, and
+    // last_error_string() if it failed.
+    statement prepare(std::string_view sql) {
+        sqlite3_stmt* stmt = nullptr;
+        record_error(sqlite3_prepare_v2(m_handle, sql.data(),
+            static_cast<int>(sql.size()), &stmt, nullptr));
+        return statement(stmt);
+    }
+
+    // "name" -> "\"name\"", with embedded quotes doubled
+    static std::string quote_identifier(std::string_view name) {
+        std::string ret{"\""};
+        for (const char c : name) {
+            if (c == '"') ret += '"';
+            ret += c;
+        }
+        ret += '"';
+        return ret;
+    }
+
+    // INSERT INTO "table" ("a","b") VALUES (?,?)
+    static std::string insert_sql(
+        std::string_view table, const std::vector<std::string_view>& columns) {
+        std::string sql{"INSERT INTO "};
+        sql += quote_identifier(table);
+        sql += " (";
+        for (size_t i = 0; i < columns.size(); ++i) {
+            if (i) sql += ',';
+            sql += quote_identifier(columns[i]);
+        }
+        sql += ") VALUES (";
+        for (size_t i = 0; i < columns.size(); ++i) {
+            sql += i ? ",?" : "?";
+        }
+        sql += ')';
+        return sql;
+    }
+
+    // Inserts rows through one prepared statement, in one transaction.
+    // src(statement&) binds the next row's values to parameters
+    // 1..columns.size() and returns true, or returns false when there are
+    // no more rows. Returns SQLITE_OK, or the first error, in which case
+    // nothing is inserted.
+    template <typename ROW_SOURCE>
+    int batch_insert(std::string_view table,
+        const std::vector<std::string_view>& columns, ROW_SOURCE&& src,
+        size_t* inserted = nullptr) {
+        statement st = prepare(insert_sql(table, columns));
+        if (!st) return m_lasterror;
+        transaction tx(*this);
+        if (!tx.active()) return m_lasterror;
+        size_t n = 0;
+        while (src(st)) {
+            const int rc = st.step();
+            if (rc != SQLITE_DONE) {
+                record_error(rc);
+                st.finalize(); // before the rollback
+                return rc;
+            }
+            st.reset();
+            ++n;
+        }
+        st.finalize();
+        const int rc = tx.commit();
+        if (rc == SQLITE_OK && inserted) *inserted = n;
+        return rc;
+    }
+
+    // A statement on loan from the statement cache: it goes back (reset,
+    // bindings cleared) when this is destroyed.
+    //
+    //  auto st = db.cached("SELECT name FROM t WHERE ID = ?");
+    //  st->bind(1, id);
+    //  sqlite::cursor c(db, *st);
+    class cached_statement {
+        sqlite* m_db = nullptr;
+        std::string m_sql;
+        statement m_st;
+
+        public:
+        cached_statement(sqlite* db, std::string&& sql, statement&& st)
+            : m_db(db), m_sql(std::move(sql)), m_st(std::move(st)) {}
+        ~cached_statement() {
+            if (m_db && m_st) m_db->cache_return(std::move(m_sql), m_st);
+        }
+        cached_statement(const cached_statement&) = delete;
+        cached_statement& operator=(const cached_statement&) = delete;
+        cached_statement(cached_statement&& rhs) noexcept
+            : m_db(rhs.m_db)
+            , m_sql(std::move(rhs.m_sql))
+            , m_st(std::move(rhs.m_st)) {
+            rhs.m_db = nullptr;
+        }
+
+        explicit operator bool() const noexcept { return bool(m_st); }
+        statement* operator->() noexcept { return &m_st; }
+        statement& operator*() noexcept { return m_st; }
+    };
+
+    // The prepared statement for sql, from the cache if it is there
+    // (a hit), else freshly prepared (a miss). Check the result with
+    // operator bool. The same sql may be in use twice at once; each use
+    // gets its own statement.
+    cached_statement cached(std::string_view sql) {
+        const auto it = m_stmt_index.find(sql);
+        if (it != m_stmt_index.end()) {
+            ++m_stmt_hits;
+            auto node = it->second;
+            m_stmt_index.erase(it);
+            std::string key = std::move(node->sql);
+            statement st = std::move(node->st);
+            m_stmt_lru.erase(node);
+            return cached_statement(this, std::move(key), std::move(st));
+        }
+        ++m_stmt_misses;
+        return cached_statement(this, std::string(sql), prepare(sql));
+    }
+
+    struct statement_cache_stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t size = 0; // statements currently held
+        size_t capacity = 0;
+    };
+    statement_cache_stats statement_cache_info() const noexcept {
+        return {m_stmt_hits, m_stmt_misses, m_stmt_lru.size(),
+            m_stmt_capacity};
+    }
+    // 0 turns caching off
+    void set_statement_cache_size(size_t n) {
+        m_stmt_capacity = n;
+        trim_statement_cache();
+    }
+    void clear_statement_cache() {
+        m_stmt_index.clear();
+        m_stmt_lru.clear();
+    }
+
+    private:
+    struct cache_entry {
+        std::string sql;
+        statement st;
+    };
+    // most recently used first; the index keys view the entries' sql
+    std::list<cache_entry> m_stmt_lru;
+    std::unordered_map<std::string_view, std::list<cache_entry>::iterator>
+        m_stmt_index;
+    size_t m_stmt_capacity{32};
+    size_t m_stmt_hits{0};
+    size_t m_stmt_misses{0};
+
+    void cache_return(std::string&& sql, statement& st) {
+        st.reset();
+        st.clear_bindings();
+        if (m_stmt_capacity == 0 || m_stmt_index.count(sql) != 0) {
+            return; // a copy was already put back; st is finalized
+        }
+        m_stmt_lru.push_front(cache_entry{std::move(sql), std::move(st)});
+        m_stmt_index.emplace(m_stmt_lru.front().sql, m_stmt_lru.begin());
+        trim_statement_cache();
+    }
+    void trim_statement_cache() {
+        while (m_stmt_lru.size() > m_stmt_capacity) {
+            m_stmt_index.erase(m_stmt_lru.back().sql);
+            m_stmt_lru.pop_back();
+        }
+    }
+
+    public:
+    // Forward-only cursor over the rows of a statement. Nothing is copied:
+    // text and blob views point into sqlite's own buffers and are only
+    // valid until the next call to next(). No ID column is needed.
+    //
+    //  auto c = db.query("SELECT name, dur FROM t WHERE dur > ?", 60);
+    //  while (c.next()) total += c.real(1);
+    class cursor {
+        sqlite* m_db = nullptr;
+        statement m_owned;
+        sqlite3_stmt* m_stmt = nullptr;
+        int m_rc = SQLITE_OK;
+
+        public:
+        // takes the statement over
+        cursor(sqlite& db, statement&& st) noexcept
+            : m_db(&db), m_owned(std::move(st)), m_stmt(m_owned.handle()) {}
+        // steps st, which must outlive the cursor; st is reset afterwards
+        cursor(sqlite& db, statement& st) noexcept
+            : m_db(&db), m_stmt(st.handle()) {}
+        ~cursor() {
+            if (m_stmt && !m_owned) sqlite3_reset(m_stmt);
+        }
+        cursor(const cursor&) = delete;
+        cursor& operator=(const cursor&) = delete;
+        cursor(cursor&& rhs) noexcept
+            : m_db(rhs.m_db)
+            , m_owned(std::move(rhs.m_owned))
+            , m_stmt(rhs.m_stmt)
+            , m_rc(rhs.m_rc) {
+            rhs.m_stmt = nullptr;
+        }
+
+        // moves to the next row; false at the end, or on error (see
+        // status()), and from then on: sqlite would start over otherwise
+        bool next() {
+            if (!m_stmt || (m_rc != SQLITE_OK && m_rc != SQLITE_ROW)) {
+                return false;
+            }
+            m_rc = sqlite3_step(m_stmt);
+            if (m_rc == SQLITE_ROW) return true;
+            m_db->record_error(m_rc);
+            return false;
+        }
+        // SQLITE_ROW while on a row, SQLITE_DONE at the end, else an error
+        int status() const noexcept { return m_rc; }
+        bool ok() const noexcept {
+            return m_stmt
+                && (m_rc == SQLITE_OK || m_rc == SQLITE_ROW
+                    || m_rc == SQLITE_DONE);
+        }
+
+        int column_count() const noexcept {
+            return sqlite3_column_count(m_stmt);
+        }
+        std::string_view column_name(int i) const noexcept {
+            const char* p = sqlite3_column_name(m_stmt, i);
+            return p ? std::string_view(p) : std::string_view{};
+        }
+        // case-insensitive, as sqlite is; -1 if there is no such column
+        int column_index(std::string_view name) const noexcept {
+            const int n = column_count();
+            for (int i = 0; i < n; ++i) {
+                const auto c = column_name(i);
+                if (c.size() == name.size()
+                    && sqlite3_strnicmp(c.data(), name.data(),
+                           static_cast<int>(name.size()))
+                        == 0) {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        // SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT, SQLITE_BLOB or
+        // SQLITE_NULL, for the current row
+        int type(int i) const noexcept { return sqlite3_column_type(m_stmt, i); }
+        bool is_null(int i) const noexcept { return type(i) == SQLITE_NULL; }
+        int64_t int64(int i) const noexcept {
+            return sqlite3_column_int64(m_stmt, i);
+        }
+        double real(int i) const noexcept {
+            return sqlite3_column_double(m_stmt, i);
+        }
+        std::string_view text(int i) const noexcept {
+            const auto* p = sqlite3_column_text(m_stmt, i);
+            if (!p) return {};
+            return std::string_view(reinterpret_cast<const char*>(p),
+                static_cast<size_t>(sqlite3_column_bytes(m_stmt, i)));
+        }
+        std::string_view blob(int i) const noexcept {
+            const auto* p = sqlite3_column_blob(m_stmt, i);
+            if (!p) return {};
+            return std::string_view(static_cast<const char*>(p),
+                static_cast<size_t>(sqlite3_column_bytes(m_stmt, i)));
+        }
+        template <typename T> T get(int i) const noexcept {
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                return text(i);
+            } else if constexpr (std::is_floating_point_v<T>) {
+                return static_cast<T>(real(i));
+            } else {
+                static_assert(std::is_integral_v<T>,
+                    "get<T>: T must be arithmetic or std::string_view");
+                return static_cast<T>(int64(i));
+            }
+        }
+    };
+
+    // Prepares sql, binds args to its parameters, and returns a cursor
+    // over the result. If anything failed, the cursor's next() returns
+    // false straight away and last_error_string() says why.
+    template <typename... ARGS>
+    cursor query(std::string_view sql, const ARGS&... args) {
+        statement st = prepare(sql);
+        if (st && st.bind_all(args...) != SQLITE_OK) {
+            record_error(sqlite3_errcode(m_handle));
+            st.finalize();
+        }
+        return cursor(*this, std::move(st));
+    }
+
+    // Calls cb(const cursor&) for every row of sql. If the callback returns
+    // a negative value, stepping stops and that value is returned (same
+    // contract as my::listdir). Returns SQLITE_OK when every row has been
+    // seen, or the sqlite error code.
+    template <typename CB, typename... ARGS>
+    int for_each_row(std::string_view sql, CB&& cb, const ARGS&... args) {
+        cursor c = query(sql, args...);
+        if (!c.ok()) return m_lasterror;
+        while (c.next()) {
+            if (const int r = cb(std::as_const(c)); r < 0) return r;
+        }
+        return c.status() == SQLITE_DONE ? SQLITE_OK : c.status();
+    }
+
+    // SELECT results kept column by column in typed buffers rather than
+    // as strings: int64 and double columns are plain vectors, text and blob
+    // columns share one arena per column. A column takes the type of its
+    // first non-NULL value; integers arriving in a float column are
+    // converted, an integer column seeing a float becomes a float column,
+    // and anything else is converted by sqlite to the column's type.
+    struct result_set {
+        struct typed_column {
+            std::string name;
+            int type = SQLITE_NULL; // until the first non-NULL value
+            std::vector<int64_t> ints;
+            std::vector<double> reals;
+            std::string arena; // text and blob bytes, back to back
+            std::vector<size_t> ends; // end of each row's bytes in arena
+            std::vector<uint64_t> nulls; // bit per row, set if NULL
+
+            bool is_null(size_t row) const noexcept {
+                return (nulls[row / 64] >> (row % 64)) & 1U;
+            }
+            int64_t int64(size_t row) const noexcept {
+                if (type == SQLITE_FLOAT) return static_cast<int64_t>(reals[row]);
+                return type == SQLITE_INTEGER ? ints[row] : 0;
+            }
+            double real(size_t row) const noexcept {
+                if (type == SQLITE_INTEGER) return static_cast<double>(ints[row]);
+                return type == SQLITE_FLOAT ? reals[row] : 0.0;
+            }
+            // text or blob bytes; empty for NULL and for numeric columns
+            std::string_view text(size_t row) const noexcept {
+                if (type != SQLITE_TEXT && type != SQLITE_BLOB) return {};
+                const size_t b = row ? ends[row - 1] : 0;
+                return std::string_view(arena.data() + b, ends[row] - b);
+            }
+        };
+
+        std::vector<typed_column> columns;
+        size_t rows = 0;
+        // value of the key column -> row, if a key column was asked for:
+        // integer values in row_index, text (or anything else) by its text
+        // in text_index. NULL keys are left out.
+        std::unordered_map<int64_t, size_t> row_index;
+        std::map<std::string, size_t, std::less<>> text_index;
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        const typed_column* find(std::string_view name) const noexcept {
+            for (const auto& c : columns) {
+                if (c.name.size() == name.size()
+                    && sqlite3_strnicmp(c.name.data(), name.data(),
+                           static_cast<int>(name.size()))
+                        == 0) {
+                    return &c;
+                }
+            }
+            return nullptr;
+        }
+        // row whose key column holds id, or npos
+        size_t row_of(int64_t id) const noexcept {
+            const auto it = row_index.find(id);
+            return it == row_index.end() ? npos : it->second;
+        }
+        // row whose (text) key column holds key, or npos
+        size_t row_of(std::string_view key) const noexcept {
+            const auto it = text_index.find(key);
+            return it == text_index.end() ? npos : it->second;
+        }
+        void clear() {
+            columns.clear();
+            row_index.clear();
+            text_index.clear();
+            rows = 0;
+        }
+    };
+
+    struct select_options {
+        // expected number of rows; 0 to grow as rows arrive
+        size_t size_hint = 0;
+        // run SELECT COUNT(*) over the query first, to size the buffers
+        bool count_first = false;
+        // column to build result_set::row_index (or text_index) from, if
+        // any; it is an error if the query has no such column
+        std::string_view key_column;
+    };
+
+    // Runs sql (with args bound to its parameters) into out. Returns
+    // SQLITE_OK or the sqlite error code (SQLITE_ERROR for a key_column
+    // that isn't in the result).
+    template <typename... ARGS>
+    int select_into(result_set& out, std::string_view sql,
+        const select_options& opts, const ARGS&... args) {
+        out.clear();
+        size_t hint = opts.size_hint;
+        if (opts.count_first) {
+            std::string count_sql{"SELECT COUNT(*) FROM ("};
+            count_sql += sql;
+            count_sql += ')';
+            cursor cc = query(count_sql, args...);
+            if (!cc.next()) return m_lasterror;
+            hint = static_cast<size_t>(cc.int64(0));
+        }
+
+        cursor c = query(sql, args...);
+        if (!c.ok()) return m_lasterror;
+        const int ncols = c.column_count();
+        out.columns.resize(static_cast<size_t>(ncols));
+        for (int i = 0; i < ncols; ++i) {
+            out.columns[static_cast<size_t>(i)].name = c.column_name(i);
+            out.columns[static_cast<size_t>(i)].nulls.reserve(hint / 64 + 1);
+        }
+        const int key = opts.key_column.empty()
+            ? -1
+            : c.column_index(opts.key_column);
+        if (key < 0 && !opts.key_column.empty()) {
+            m_lasterror = SQLITE_ERROR;
+            m_slasterror = "no such key column: ";
+            m_slasterror += opts.key_column;
+            report_error();
+            return m_lasterror;
+        }
+        if (key >= 0) out.row_index.reserve(hint);
+
+        while (c.next()) {
+            const size_t row = out.rows;
+            for (int i = 0; i < ncols; ++i) {
+                append_cell(
+                    out.columns[static_cast<size_t>(i)], c, i, row, hint);
+            }
+            if (key >= 0) add_key(out, c, key, row);
+            ++out.rows;
+        }
+        return c.status() == SQLITE_DONE ? SQLITE_OK : c.status();
+    }
+    int select_into(result_set& out, std::string_view sql) {
+        return select_into(out, sql, select_options{});
+    }
+
+    private:
+    static void add_key(
+        result_set& out, const cursor& c, int key, size_t row) {
+        switch (c.type(key)) {
+            case SQLITE_NULL: break;
+            case SQLITE_INTEGER:
+                out.row_index.emplace(c.int64(key), row);
+                break;
+            default: out.text_index.emplace(c.text(key), row); break;
+        }
+    }
+    static void append_cell(result_set::typed_column& col, const cursor& c,
+        int i, size_t row, size_t hint) {
+        if (row % 64 == 0) col.nulls.push_back(0);
+        const int t = c.type(i);
+        if (t == SQLITE_NULL) {
+            col.nulls[row / 64] |= uint64_t{1} << (row % 64);
+        } else if (col.type == SQLITE_NULL) {
+            // first value: the rows before it were all NULL
+            col.type = t;
+            switch (t) {
+                case SQLITE_INTEGER:
+                    col.ints.reserve(hint);
+                    col.ints.resize(row);
+                    break;
+                case SQLITE_FLOAT:
+                    col.reals.reserve(hint);
+                    col.reals.resize(row);
+                    break;
+                default:
+                    col.ends.reserve(hint);
+                    col.ends.resize(row);
+                    break;
+            }
+        } else if (col.type == SQLITE_INTEGER && t == SQLITE_FLOAT) {
+            col.type = SQLITE_FLOAT;
+            col.reals.reserve((std::max)(hint, col.ints.capacity()));
+            for (const auto v : col.ints) {
+                col.reals.push_back(static_cast<double>(v));
+            }
+            col.ints = std::vector<int64_t>();
+        }
+
+        const bool null = t == SQLITE_NULL;
+        switch (col.type) {
+            case SQLITE_NULL: break; // nothing but NULLs so far
+            case SQLITE_INTEGER:
+                col.ints.push_back(null ? 0 : c.int64(i));
+                break;
+            case SQLITE_FLOAT:
+                col.reals.push_back(null ? 0.0 : c.real(i));
+                break;
+            default:
+                if (!null) {
+                    col.arena += col.type == SQLITE_BLOB ? c.blob(i) : c.text(i);
+                }
+                col.ends.push_back(col.arena.size());
+                break;
+        }
+    }
+
+    public:
     int exec(std::string_view sql) {
         char* errmsg{nullptr};
+        m_slasterror.clear();
 
         if (sql.find("INSERT") == 0) {
             // inserting data.
@@ -161,7 +864,6 @@ struct sqlite {
             this->m_row_index = 0;
             this->m_rows.clear();
             m_columns.clear();
-            m_slasterror.clear();
             m_lasterror = sqlite3_exec(
                 m_handle, sql.data(), select_callback, this, &errmsg);
         } else {
@@ -169,7 +871,12 @@ struct sqlite {
                 = sqlite3_exec(m_handle, sql.data(), callback, this, &errmsg);
         }
 
-        if (m_slasterror.empty()) set_last_error(&errmsg);
+        if (m_slasterror.empty()) {
+            set_last_error(&errmsg);
+        } else {
+            // select_callback() said why it stopped
+            sqlite3_free(errmsg);
+        }
         this->m_mode = modes::none;
         return m_lasterror;
     }
@@ -177,12 +884,14 @@ struct sqlite {
     size_t row_count(std::string_view table) {
         std::string sql{"SELECT COUNT(*) FROM "};
         sql += table;
-        m_mode = modes::getting_row_count;
-        auto ret = this->exec(sql);
-        if (ret != SQLITE_OK) {
+        auto st = cached(sql);
+        if (!st) return 0;
+        const int rc = st->step();
+        if (rc != SQLITE_ROW) {
+            record_error(rc);
             return 0;
         }
-
+        m_row_count = static_cast<size_t>(sqlite3_column_int64(st->handle(), 0));
         return m_row_count;
     }
     template <typename CB> int exec(std::string_view sql, CB&& cb) {
@@ -287,13 +996,301 @@ msg
     sqlite3* m_handle = nullptr;
     std::string m_path;
     bool m_errs_to_stderr{true};
+    // after sqlite3_exec(), which has already set m_lasterror
     void set_last_error(char** sqlerr) {
         if (*sqlerr) {
             m_slasterror = *sqlerr;
             sqlite3_free(*sqlerr);
+        } else if (m_lasterror != SQLITE_OK) {
+            m_slasterror = sqlite3_errmsg(m_handle);
         } else {
             m_slasterror.clear();
         }
+        if (m_lasterror != SQLITE_OK) report_error();
+    }
+    void report_error() const {
+        if (errors_to_stderr()) {
+            fprintf(stderr, "C++ sqlite error, (%d) %s\n", m_lasterror,
+                m_slasterror.c_str());
+        }
+    }
+};
+
+// One writer and N reader connections to the same database file, in WAL
+// mode, so the readers run alongside each other and alongside the writer.
+// A connection is leased to one thread at a time; a thread asking again
+// while it holds one gets the same connection back. That is why a lease
+// can't be moved: it belongs to the thread that took it, and must be
+// released there too.
+//
+//  sqlite_pool pool("music.db", 4);
+//  {
+//      auto db = pool.reader();
+//      auto c = db->query("SELECT ...");
+//      while (c.next()) { ... }
+//  } // connection goes back to the pool
+//
+// Each connection keeps its own last_error_string().
+class sqlite_pool {
+    struct slot {
+        std::unique_ptr<sqlite> db;
+        std::thread::id owner;
+        size_t uses = 0;
+    };
+
+    public:
+    class lease {
+        friend class sqlite_pool;
+        sqlite_pool* m_pool = nullptr;
+        slot* m_slot = nullptr;
+
+        lease(sqlite_pool* pool, slot* s) noexcept : m_pool(pool), m_slot(s) {}
+
+        public:
+        ~lease() { release(); }
+        lease(const lease&) = delete;
+        lease& operator=(const lease&) = delete;
+        lease(lease&&) = delete;
+        lease& operator=(lease&&) = delete;
+
+        explicit operator bool() const noexcept { return m_slot != nullptr; }
+        sqlite* operator->() const noexcept { return m_slot->db.get(); }
+        sqlite& operator*() const noexcept { return *m_slot->db; }
+        void release() noexcept {
+            if (m_pool) m_pool->give_back(m_slot);
+            m_pool = nullptr;
+            m_slot = nullptr;
+        }
+    };
+
+    // readers == 0: one per hardware thread. Throws std::runtime_error if
+    // a connection cannot be opened or WAL mode cannot be set.
+    explicit sqlite_pool(std::string_view filepath, size_t readers = 0,
+        int busy_timeout_ms = 5000) {
+        constexpr int rw = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE
+            | SQLITE_OPEN_NOMUTEX;
+        constexpr int ro = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX;
+
+        m_writer.db = std::make_unique<sqlite>(filepath, rw);
+        if (m_writer.db->set_wal_mode() != SQLITE_OK) {
+            throw std::runtime_error(
+                std::string(m_writer.db->last_error_string()));
+        }
+        m_writer.db->set_busy_timeout(busy_timeout_ms);
+
+        if (readers == 0) {
+            readers = (std::max)(1U, std::thread::hardware_concurrency());
+        }
+        m_readers = std::vector<slot>(readers);
+        for (auto& r : m_readers) {
+            r.db = std::make_unique<sqlite>(filepath, ro);
+            r.db->set_busy_timeout(busy_timeout_ms);
+        }
+    }
+    sqlite_pool(const sqlite_pool&) = delete;
+    sqlite_pool& operator=(const sqlite_pool&) = delete;
+
+    // Waits for a free read-only connection.
+    lease reader() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const auto me = std::this_thread::get_id();
+        for (;;) {
+            slot* free_slot = nullptr;
+            for (auto& r : m_readers) {
+                if (r.uses != 0 && r.owner == me) return take(r, me);
+                if (r.uses == 0 && !free_slot) free_slot = &r;
+            }
+            if (free_slot) return take(*free_slot, me);
+            m_cv.wait(lock);
+        }
+    }
+
+    // Waits for the (only) connection that may write.
+    lease writer() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const auto me = std::this_thread::get_id();
+        m_cv.wait(lock, [&] {
+            return m_writer.uses == 0 || m_writer.owner == me;
+        });
+        return take(m_writer, me);
+    }
+
+    size_t reader_count() const noexcept { return m_readers.size(); }
+
+    private:
+    lease take(slot& s, std::thread::id me) noexcept {
+        s.owner = me;
+        ++s.uses;
+        return lease(this, &s);
+    }
+    void give_back(slot* s) noexcept {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--s->uses != 0) return;
+            s->owner = std::thread::id();
+        }
+        m_cv.notify_all();
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    slot m_writer;
+    std::vector<slot> m_readers;
+};
+
+// Runs sqlite work on a dedicated thread, so the caller can get on with
+// something else in the meantime. Results come back through std::future.
+//
+//  sqlite_async db("music.db");
+//  auto n = db.submit([](sqlite& c) { return c.row_count("tracks"); });
+//  auto w = db.write("INSERT INTO plays VALUES (42)");
+//  ...
+//  n.get(); w.get();
+//
+// Writes waiting in the queue together are committed together, in one
+// transaction (group commit): one fsync for the lot, rather than one each.
+// Each write runs inside its own savepoint, so one that fails is rolled
+// back alone and the others still commit. Jobs run in submission order;
+// the destructor finishes any that are still queued.
+//
+// A write is already inside a transaction, so it must not BEGIN or COMMIT
+// by itself (db.exec("BEGIN") fails there). sqlite::transaction is fine:
+// it becomes a savepoint, so batch_insert() and my::sqlite_import() work
+// as writes, and are committed with the rest of their group.
+class sqlite_async {
+    public:
+    explicit sqlite_async(std::string_view filepath, size_t max_group = 1024)
+        : m_db(filepath), m_max_group((std::max)(size_t{1}, max_group)) {
+        m_thread = std::thread([this] { run(); });
+    }
+    ~sqlite_async() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    }
+    sqlite_async(const sqlite_async&) = delete;
+    sqlite_async& operator=(const sqlite_async&) = delete;
+
+    // fn(sqlite&), run on the worker; the future holds its result (or
+    // whatever it threw).
+    template <typename FN> auto submit(FN&& fn) {
+        using R = std::invoke_result_t<std::decay_t<FN>&, sqlite&>;
+        auto task = std::make_shared<std::packaged_task<R(sqlite&)>>(
+            std::forward<FN>(fn));
+        auto ret = task->get_future();
+        job j;
+        j.read = [task](sqlite& db) { (*task)(db); };
+        push(std::move(j));
+        return ret;
+    }
+
+    // fn(sqlite&) returns SQLITE_OK or an error code. The future is set
+    // once the group it was in has committed: to fn's error if it failed,
+    // else to the result of the COMMIT. fn runs inside the group's
+    // transaction: use sqlite::transaction, not BEGIN, for its own.
+    template <typename FN,
+        std::enable_if_t<std::is_invocable_r_v<int, std::decay_t<FN>&, sqlite&>,
+            int> = 0>
+    std::future<int> write(FN&& fn) {
+        auto f = std::make_shared<std::decay_t<FN>>(std::forward<FN>(fn));
+        job j;
+        j.write = [f](sqlite& db) { return (*f)(db); };
+        auto ret = j.done.get_future();
+        push(std::move(j));
+        return ret;
+    }
+    std::future<int> write(std::string sql) {
+        return write([sql = std::move(sql)](sqlite& db) { return db.exec(sql); });
+    }
+
+    // number of commits so far, each covering one or more writes
+    size_t group_commits() const noexcept { return m_commits.load(); }
+
+    private:
+    struct job {
+        std::function<void(sqlite&)> read;
+        std::function<int(sqlite&)> write;
+        std::promise<int> done;
+    };
+
+    sqlite m_db; // only ever touched by m_thread
+    size_t m_max_group;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<job> m_queue;
+    bool m_stop = false;
+    std::atomic<size_t> m_commits{0};
+    std::thread m_thread;
+
+    void push(job&& j) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(j));
+        }
+        m_cv.notify_one();
+    }
+
+    int raw_exec(const char* sql) {
+        return sqlite3_exec(m_db.handle(), sql, nullptr, nullptr, nullptr);
+    }
+
+    void run() {
+        std::vector<job> batch;
+        for (;;) {
+            batch.clear();
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+                if (m_queue.empty()) return; // stopping, and all done
+                const bool writes = bool(m_queue.front().write);
+                do {
+                    batch.push_back(std::move(m_queue.front()));
+                    m_queue.pop_front();
+                } while (writes && batch.size() < m_max_group
+                    && !m_queue.empty() && m_queue.front().write);
+            }
+            if (batch.front().read) {
+                batch.front().read(m_db);
+            } else {
+                write_group(batch);
+            }
+        }
+    }
+
+    void write_group(std::vector<job>& batch) {
+        std::vector<int> rcs(batch.size(), SQLITE_OK);
+        std::vector<std::exception_ptr> errs(batch.size());
+        sqlite::transaction tx(m_db);
+        if (!tx.active()) {
+            for (auto& j : batch) {
+                j.done.set_value(m_db.last_error_code());
+            }
+            return;
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+            raw_exec("SAVEPOINT group_write");
+            try {
+                rcs[i] = batch[i].write(m_db);
+            } catch (...) {
+                errs[i] = std::current_exception();
+            }
+            if (rcs[i] != SQLITE_OK || errs[i]) {
+                raw_exec("ROLLBACK TO group_write");
+            }
+            raw_exec("RELEASE group_write");
+        }
+        const int rc = tx.commit();
+        ++m_commits;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (errs[i]) {
+                batch[i].done.set_exception(errs[i]);
+            } else {
+                batch[i].done.set_value(rcs[i] != SQLITE_OK ? rcs[i] : rc);
+            }
+        }
     }
 };
 
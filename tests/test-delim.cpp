@@ -0,0 +1,694 @@
+// Tests for the delimited file readers and what is built on them.
+#ifdef NDEBUG
+#undef NDEBUG // asserts are the tests, so keep them in any build
+#endif
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+#include "../my_delim_file.hpp"
+#include "../my_delim_aggregate.hpp"
+#include "../my_delim_query.hpp"
+
+namespace {
+
+std::string temp_path(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+std::string write_file(const char* name, std::string_view contents) {
+    const auto path = temp_path(name);
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    return path;
+}
+
+int test_stream_reader() {
+    // mixed line endings, a leading control char, no final newline
+    std::string text = "Artist\tDur\tGender\r\n";
+    for (int i = 0; i < 1000; ++i) {
+        text += "\x03" "artist" + std::to_string(i) + "\t3:"
+            + std::to_string(i % 60) + "\t" + (i % 2 ? "M" : "F")
+            + (i % 3 ? "\r\n" : "\n");
+    }
+    text += "\r\nlast\t1:00\tF";
+    const auto path = write_file("test-delim-stream.tsv", text);
+
+    // buffers smaller than a line, a few lines, and the whole file
+    for (const size_t buffer_size : {7U, 64U, 1U << 20U}) {
+        my::DelimitedStreamReader r(path, "\t", true, buffer_size);
+        size_t rows = 0;
+        std::string last;
+        const int rc = r.for_each_row([&](const auto& row) {
+            assert(row.row == rows);
+            assert(row.size() == 3);
+            if (row.row == 5) {
+                assert(row[0] == "artist5");
+                assert(row[1] == "3:5");
+                assert(row[2] == "M");
+                assert(row.line_number == 7);
+            }
+            assert(row[3].empty()); // out of range
+            last = std::string(row[0]);
+            ++rows;
+            return 0;
+        });
+        assert(rc == 0);
+        assert(rows == 1001 && r.rows_read() == 1001);
+        assert(last == "last");
+        assert(r.column_names().size() == 3);
+        assert(r.column_index("dur") == 1);
+        assert(r.column_index("nope") == -1);
+
+        const int stop = r.for_each_row(
+            [](const auto& row) { return row.row == 10 ? -5 : 0; });
+        assert(stop == -5);
+        assert(r.rows_read() == 11);
+    }
+
+    // without a header, the first line is data
+    my::DelimitedStreamReader nh(path, "\t", false);
+    size_t rows = 0;
+    nh.for_each_row([&](const auto&) {
+        ++rows;
+        return 0;
+    });
+    assert(rows == 1002 && nh.column_names().empty());
+
+    bool threw = false;
+    try {
+        my::DelimitedStreamReader missing(temp_path("test-delim-nope.tsv"));
+        missing.for_each_row([](const auto&) { return 0; });
+    } catch (const std::system_error&) {
+        threw = true;
+    }
+    assert(threw);
+    return 0;
+}
+
+using reader = my::DelimitedTextReader;
+
+int test_materialise() {
+    std::string text = "Id\tArtist\tDur\tScore\tSparse\r\n";
+    for (int i = 0; i < 100; ++i) {
+        text += std::to_string(i) + "\tartist" + std::to_string(i) + "\t3:"
+            + std::to_string(10 + i % 50) + "\t" + std::to_string(i * 0.5)
+            + "\t" + (i % 10 ? "" : "7") + "\r\n";
+    }
+    const auto path = write_file("test-delim-typed.tsv", text);
+    reader rd(path);
+    assert(rd.rowcount() == 100);
+    assert(reader::infer_type(*rd.column("Id")) == reader::column_type::int64);
+    assert(reader::infer_type(*rd.column("Score"))
+        == reader::column_type::real);
+    assert(reader::infer_type(*rd.column("Dur"))
+        == reader::column_type::duration);
+    assert(reader::infer_type(*rd.column("Artist"))
+        == reader::column_type::text);
+    // empty values don't count against a type
+    assert(reader::infer_type(*rd.column("Sparse"))
+        == reader::column_type::int64);
+
+    rd.materialise_all();
+    const auto& dur = rd.column("Dur")->typed;
+    assert(dur.secs.size() == 100 && dur.parse_errors == 0);
+    assert(dur.secs[1] == 191);
+    assert(rd.column("Id")->typed.ints[99] == 99);
+    assert(rd.column("Score")->typed.reals[3] == 1.5);
+    const auto& sparse = rd.column("Sparse")->typed;
+    assert(sparse.parse_errors == 0 && sparse.ints[10] == 7);
+    assert(sparse.ints[11] == 0);
+
+    // forcing the wrong type counts every value as an error; the text is
+    // still there
+    const auto* a = rd.materialise("Artist", reader::column_type::int64);
+    assert(a->typed.parse_errors == 100);
+    assert(a->values[4] == "artist4");
+    // and materialising again replaces it
+    a = rd.materialise("Artist", reader::column_type::text);
+    assert(a->typed.parse_errors == 0 && a->typed.ints.empty());
+    return 0;
+}
+
+int test_dictionary() {
+    std::string text = "Id\tArtist\tGender\tSpelling\r\n";
+    const char* spellings[] = {"abc", "ABC", "Abc", "aBc", "abC", "aBC"};
+    for (int i = 0; i < 100; ++i) {
+        text += std::to_string(i) + "\t" + (i % 2 ? "ABBA" : "abba")
+            + std::to_string(i % 5) + "\t" + (i % 3 ? "M" : "F") + "\t"
+            + spellings[i % 6] + std::to_string(i % 5) + "\r\n";
+    }
+    const auto path = write_file("test-delim-dict.tsv", text);
+    reader rd(path);
+    assert(reader::infer_type(*rd.column("Gender"))
+        == reader::column_type::dictionary);
+    // 30 spellings, but only 5 values once case is ignored
+    assert(reader::infer_type(*rd.column("Spelling"))
+        == reader::column_type::dictionary);
+    rd.materialise_all();
+
+    const auto* artist = rd.column("Artist");
+    assert(artist->typed.type == reader::column_type::dictionary);
+    const auto& d = artist->typed.dict;
+    assert(d.size() == 100 && d.distinct() == 5);
+    // the first spelling seen is the one kept
+    assert(d.value(0) == "abba0" && d.value(5) == "abba0");
+    assert(d.codes[0] == d.codes[10]);
+    // round trip: every row decodes to its own value, ignoring case
+    for (size_t r = 0; r < d.size(); ++r) {
+        assert(my::utils::strings::ci_equal(d.value(r), artist->values[r]));
+    }
+    assert(d.find_code("ABBA3") == d.codes[3]);
+    assert(d.find_code("queen") == my::dictionary_encoded::invalid_code);
+
+    const auto exact = my::make_dictionary(artist->values, false);
+    assert(exact.distinct() == 10);
+    assert(exact.find_code("abba3") != exact.find_code("ABBA3"));
+    for (size_t r = 0; r < exact.size(); ++r) {
+        assert(exact.value(r) == artist->values[r]);
+    }
+
+    const auto counts = rd.column("Gender")->typed.dict.counts();
+    assert(counts.size() == 2 && counts[0] + counts[1] == 100);
+    assert(counts[rd.column("Gender")->typed.dict.find_code("F")] == 34);
+    return 0;
+}
+
+int test_column_index() {
+    const auto path = write_file(
+        "test-delim-index.tsv", "Id\tArtist\tGender\n1\tabba\tF\n2\tblur\tM\n");
+    reader rd(path);
+    assert(rd.column_index("Artist") == 1);
+    assert(rd.column_index("artist") == 1);
+    assert(rd.column_index("GENDER") == 2);
+    assert(rd.column_index("Gende") == reader::npos);
+    assert(rd.column_index("Genders") == reader::npos);
+    assert(rd.column_index("") == reader::npos);
+    assert(rd.find_column("ID")->name == "Id");
+    assert(rd.find_column("Idx") == nullptr);
+    assert(rd.column("gEnDeR")->index == 2);
+    assert(rd.column("nope") == nullptr);
+    assert(rd.materialise("id")->typed.ints[1] == 2);
+    assert(rd.materialise("nope", reader::column_type::int64) == nullptr);
+
+    // the hash and the compare agree about case, and only about case
+    const my::column_name_hash h;
+    const my::column_name_equal eq;
+    assert(h("Artist") == h("ARTIST") && eq("Artist", "aRTIST"));
+    assert(!eq("Artist", "Artis") && !eq("a-b", "a_b"));
+    return 0;
+}
+
+// accepts limit bytes, then fails every write
+struct failing_buf : std::streambuf {
+    size_t limit;
+    explicit failing_buf(size_t n) : limit(n) {}
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        if (static_cast<size_t>(n) > limit) return 0;
+        limit -= static_cast<size_t>(n);
+        return n;
+    }
+    int_type overflow(int_type c) override {
+        return xsputn(nullptr, 1) == 1 ? c : traits_type::eof();
+    }
+};
+
+int test_export() {
+    std::string text = "Id\tArtist\tNote\r\n";
+    for (int i = 0; i < 1000; ++i) {
+        text += std::to_string(i) + "\tO'Brien " + std::to_string(i)
+            + "\tsay \"hi\"\r\n";
+    }
+    const auto path = write_file("test-delim-export.tsv", text);
+    reader rd(path);
+
+    std::string row;
+    std::string expected;
+    for (size_t r = 0; r < rd.rowcount(); ++r) {
+        rd.rowData(row, r);
+        assert(row.size() == rd.row_data_size(r, ",", true, true));
+        std::stringstream ss;
+        rd.rowData(true, ss, r);
+        assert(ss.str() == row);
+        expected += row + "\n";
+    }
+    assert(row == "'999','O''Brien 999','say \"\"hi\"\"'");
+
+    std::string all = "keep:";
+    assert(rd.append_rows(all) == 1000);
+    assert(all == "keep:" + expected);
+
+    std::string part;
+    assert(rd.append_rows(part, 998, 10, "\t", false, false, "\r\n") == 2);
+    assert(part
+        == "998\tO'Brien 998\tsay \"hi\"\r\n999\tO'Brien 999\tsay \"hi\"\r\n");
+    assert(rd.append_rows(part, 1000) == 0);
+
+    // a flush threshold much smaller than the output
+    std::stringstream os;
+    assert(rd.export_rows(os, 0, reader::npos, ",", true, true, "\n", 100)
+        == 1000);
+    assert(os.str() == expected);
+
+    // a stream that fails part way: only the rows that made it count
+    failing_buf fb(expected.size() / 2);
+    std::ostream bad(&fb);
+    const auto n
+        = rd.export_rows(bad, 0, reader::npos, ",", true, true, "\n", 100);
+    assert(!bad && n > 0 && n < 1000);
+
+    const auto out = temp_path("test-delim-export.csv");
+    assert(rd.export_rows_to_file(out).code() == std::error_code());
+    std::string back;
+    my::utils::file_open_and_read_all(out, back);
+    assert(back == expected);
+    assert(rd.export_rows_to_file(temp_path("no/such/dir/x.csv")).code()
+        != std::error_code());
+    return 0;
+}
+
+std::string cache_text(char first) {
+    std::string text = "Id\tArtist\tDur\tGender\r\n";
+    for (int i = 0; i < 5000; ++i) {
+        text += std::to_string(i) + "\t" + first + "rtist"
+            + std::to_string(i % 50) + "\t3:" + std::to_string(10 + i % 50)
+            + "\t" + (i % 3 ? "M" : "F") + "\r\n";
+    }
+    return text;
+}
+
+int test_cache() {
+    namespace fs = std::filesystem;
+    const auto path = write_file("test-delim-cache.tsv", cache_text('a'));
+    // a whole second, so that a rewrite can land later in the same one
+    const auto when
+        = std::chrono::floor<std::chrono::seconds>(fs::last_write_time(path));
+    fs::last_write_time(path, when);
+    const std::string cache = path + ".dtrcache";
+    fs::remove(cache);
+
+    std::string expected;
+    {
+        reader rd(path, "\t", reader::cache_policy::use);
+        assert(!rd.loaded_from_cache() && rd.cache_path() == cache);
+        assert(fs::exists(cache));
+        rd.materialise_all();
+        assert(rd.save_cache().code() == std::error_code());
+        rd.append_rows(expected);
+    }
+    {
+        reader rd(path, "\t", reader::cache_policy::use_verified);
+        assert(rd.loaded_from_cache());
+        std::string got;
+        rd.append_rows(got);
+        assert(got == expected);
+        // the materialised columns come back too
+        assert(rd.column("dur")->typed.type == reader::column_type::duration);
+        assert(rd.column("dur")->typed.secs[1] == 191);
+        assert(rd.column("id")->typed.ints[4999] == 4999);
+        assert(rd.column("artist")->typed.dict.distinct() == 50);
+        assert(rd.column("Gender")->typed.dict.value(0) == "F");
+    }
+    {
+        reader rd(path, "\t", reader::cache_policy::none);
+        assert(!rd.loaded_from_cache());
+    }
+
+    // same size, same second, different bytes: stale
+    write_file("test-delim-cache.tsv", cache_text('A'));
+    fs::last_write_time(path, when + std::chrono::milliseconds(500));
+    {
+        reader rd(path, "\t", reader::cache_policy::use);
+        assert(!rd.loaded_from_cache());
+        assert(rd.column("artist")->values[0] == "Artist0");
+    }
+    {
+        reader rd(path, "\t", reader::cache_policy::use);
+        assert(rd.loaded_from_cache());
+        assert(rd.column("artist")->values[0] == "Artist0");
+    }
+
+    // grown: stale, then cached again
+    {
+        std::ofstream f(path, std::ios::binary | std::ios::app);
+        f << "5000\tx\t1:00\tM\r\n";
+    }
+    fs::last_write_time(path, when + std::chrono::seconds(2));
+    {
+        reader rd(path, "\t", reader::cache_policy::use);
+        assert(!rd.loaded_from_cache() && rd.rowcount() == 5001);
+    }
+
+    // a damaged cache is ignored, not trusted
+    {
+        std::fstream f(
+            cache, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(100);
+        f.write("\xff\xff\xff\xff\xff\xff\xff\xff", 8);
+    }
+    {
+        reader rd(path, "\t", reader::cache_policy::use);
+        assert(rd.rowcount() == 5001);
+        assert(rd.column("id")->values[5000] == "5000");
+    }
+    // nor is one made with another delimiter
+    {
+        reader rd(path, ",", reader::cache_policy::use);
+        assert(!rd.loaded_from_cache() && rd.columns().size() == 1);
+        reader again(path, "\t", reader::cache_policy::use);
+        assert(!again.loaded_from_cache() && again.columns().size() == 4);
+    }
+    return 0;
+}
+
+void append_file(const std::string& path, std::string_view text) {
+    std::ofstream f(path, std::ios::binary | std::ios::app);
+    f.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+int test_refresh() {
+    namespace fs = std::filesystem;
+    // the last row has no line end yet
+    const auto path = write_file("test-delim-refresh.tsv",
+        "Id\tArtist\tDur\n1\tabba\t3:00\n2\tABBA\t3:10\n3\tqueen\t4:0");
+    fs::remove(path + ".dtrcache");
+    reader rd(path, "\t", reader::cache_policy::use);
+    assert(rd.rowcount() == 3);
+    rd.materialise("Id", reader::column_type::int64);
+    rd.materialise("Artist", reader::column_type::dictionary);
+    rd.materialise("Dur", reader::column_type::duration);
+    assert(rd.column("dur")->typed.secs[2] == 240);
+    assert(rd.refresh() == 0);
+
+    // the partial row is completed (and re-parsed), and one more added
+    append_file(path, "5\n4\tqueenie\t1:00\n");
+    assert(rd.refresh() == 2);
+    assert(rd.rowcount() == 4);
+    assert(rd.column("dur")->typed.secs[2] == 245);
+    assert(rd.column("artist")->typed.dict.distinct() == 3);
+    assert(rd.column("id")->typed.ints[3] == 4);
+
+    // partial again, then completed with a CRLF and a blank line
+    append_file(path, "5\tzz");
+    assert(rd.refresh() == 1);
+    assert(rd.column("artist")->typed.dict.distinct() == 4);
+    append_file(path, "z\t0:01\r\n\r\n6\tabba\t0:02\r\n");
+    assert(rd.refresh() == 2);
+    assert(rd.rowcount() == 6);
+    const auto& d = rd.column("artist")->typed.dict;
+    assert(d.distinct() == 4 && d.value(4) == "zzz" && d.codes[5] == 0);
+
+    // what refresh() built is what a fresh parse gives, and it caches
+    std::string refreshed;
+    rd.append_rows(refreshed, 0, reader::npos, "|", false, false);
+    assert(refreshed
+        == "1|abba|3:00\n2|ABBA|3:10\n3|queen|4:05\n4|queenie|1:00\n"
+           "5|zzz|0:01\n6|abba|0:02\n");
+    assert(rd.save_cache().code() == std::error_code());
+    reader cached(path, "\t", reader::cache_policy::use_verified);
+    assert(cached.loaded_from_cache());
+    std::string got;
+    cached.append_rows(got, 0, reader::npos, "|", false, false);
+    assert(got == refreshed);
+
+    // refreshing a reader that came from the cache
+    append_file(path, "7\tx\t1\n");
+    assert(cached.refresh() == 1 && cached.rowcount() == 7);
+    assert(cached.column("artist")->typed.dict.distinct() == 5);
+    reader fresh(path);
+    std::string a;
+    std::string b;
+    fresh.append_rows(a);
+    cached.append_rows(b);
+    assert(a == b);
+
+    // shrunk or rewritten: can't be caught up
+    write_file("test-delim-refresh.tsv", "Id\n");
+    assert(cached.refresh() == -1);
+
+    // the header itself has no line end yet
+    const auto head = write_file("test-delim-refresh-head.tsv", "Art");
+    fs::remove(head + ".dtrcache");
+    reader partial(head, "\t", reader::cache_policy::use);
+    assert(partial.columns().size() == 1 && partial.rowcount() == 0);
+    assert(partial.save_cache().code() == std::error_code());
+    reader partial_cached(head, "\t", reader::cache_policy::use_verified);
+    assert(partial_cached.loaded_from_cache());
+    append_file(head, "ist\tDur\nabba\t3:00\n");
+    for (auto* r : {&partial, &partial_cached}) {
+        assert(r->refresh() == 1);
+        assert(r->columns().size() == 2 && r->rowcount() == 1);
+        assert(r->column("artist") && r->column("art") == nullptr);
+        assert(r->column("artist")->values[0] == "abba");
+        assert(r->column("dur")->values[0] == "3:00");
+    }
+    append_file(head, "queen\t4:00\n");
+    assert(partial.refresh() == 1 && partial.rowcount() == 2);
+    assert(partial.column("dur")->values[1] == "4:00");
+    return 0;
+}
+
+int test_query() {
+    using namespace my::query;
+    const char* spellings[] = {"Abba", "ABBA", "abba", "queen"};
+    std::string text = "Id\tArtist\tDur\tGender\n";
+    for (int i = 0; i < 1000; ++i) {
+        text += std::to_string(i) + "\t" + spellings[i % 4]
+            + std::to_string(i % 7) + "\t" + std::to_string(i % 10)
+            + ":00\t" + (i % 3 ? "M" : "F") + "\n";
+    }
+    const auto path = write_file("test-delim-query.tsv", text);
+    reader rd(path);
+    size_t females = 0;
+    for (int i = 0; i < 1000; ++i) {
+        females += i % 3 == 0 ? 1 : 0;
+    }
+
+    // text columns
+    assert(equals(*rd.column("gender"), "F").count() == females);
+    assert(equals(*rd.column("gender"), "f").count() == 0);
+    assert(equals(*rd.column("gender"), "f", true).count() == females);
+    const auto abba_cs = prefix(*rd.column("artist"), "Abba");
+    const auto abba_ci = prefix(*rd.column("artist"), "ABBA", true);
+    assert(abba_cs.count() == 250 && abba_ci.count() == 750);
+    const std::vector<std::string_view> wanted{"abba2", "ABBA1", "nope"};
+    const auto set_cs = in_set(*rd.column("artist"), wanted);
+    const auto set_ci = in_set(*rd.column("artist"), wanted, true);
+    const auto eq_cs = equals(*rd.column("artist"), "ABBA1");
+    const auto eq_ci = equals(*rd.column("artist"), "ABBA1", true);
+
+    // the same answers once dictionary-encoded, either way about case
+    for (const bool dict_ci : {true, false}) {
+        column_t artist = *rd.column("artist");
+        artist.typed.type = reader::column_type::dictionary;
+        artist.typed.dict = reader::unique_column_codes(artist, dict_ci);
+        const auto same = [](const selection& a, const selection& b) {
+            return a.words() == b.words();
+        };
+        assert(same(prefix(artist, "Abba"), abba_cs));
+        assert(same(prefix(artist, "ABBA", true), abba_ci));
+        assert(same(in_set(artist, wanted), set_cs));
+        assert(same(in_set(artist, wanted, true), set_ci));
+        assert(same(equals(artist, "ABBA1"), eq_cs));
+        assert(same(equals(artist, "ABBA1", true), eq_ci));
+        assert(equals(artist, "nope").count() == 0);
+    }
+
+    // combining selections
+    rd.materialise("gender", reader::column_type::dictionary);
+    rd.materialise("dur", reader::column_type::duration);
+    rd.materialise("id", reader::column_type::int64);
+    const auto f = equals(*rd.column("gender"), "F");
+    assert(f.count() == females);
+    const auto d = range(*rd.column("dur"), 300, 540);
+    const auto both = f & d;
+    size_t expected = 0;
+    for (int i = 0; i < 1000; ++i) {
+        expected += i % 3 == 0 && i % 10 >= 5 ? 1 : 0;
+    }
+    assert(both.count() == expected);
+    for (const auto r : both.rows()) {
+        assert(r % 3 == 0 && r % 10 >= 5);
+    }
+    assert((~f).count() == 1000 - females);
+    assert((f | ~f).count() == 1000);
+    assert((f & ~f).count() == 0);
+
+    const auto ids = range(*rd.column("id"), int64_t{10}, int64_t{19});
+    assert(ids.count() == 10 && ids.rows()[0] == 10);
+    assert(range(*rd.column("id"), 10.5, 12.0).count() == 2);
+    bool threw = false;
+    try {
+        range(*rd.column("artist"), 0, 1);
+    } catch (const std::exception&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // a size that isn't a multiple of 64 keeps its tail clear
+    selection odd(70, true);
+    assert(odd.count() == 70 && (~odd).count() == 0);
+    odd.set(69, false);
+    assert(!odd.test(69) && odd.count() == 69 && (~odd).rows() == std::vector<size_t>{69});
+    return 0;
+}
+
+int test_group_by() {
+    using namespace my::aggregate;
+    const char* spellings[] = {"Abba", "ABBA", "abba", "queen"};
+    std::string text = "Artist\tDur\tTitle\n";
+    for (int i = 0; i < 1000; ++i) {
+        text += std::string(spellings[i % 4]) + "\t" + std::to_string(i % 10)
+            + ":00\t" + (i % 2 ? "x" : "X") + std::to_string(i % 3) + "\n";
+    }
+    const auto path = write_file("test-delim-group.tsv", text);
+    reader rd(path);
+    rd.materialise("dur", reader::column_type::duration);
+    const auto& artist = *rd.column("artist");
+    const auto* dur = rd.column("dur");
+
+    // what the groups should be, by hand
+    struct want {
+        size_t count = 0;
+        double sum = 0;
+        double min = 1e9;
+        double max = -1;
+        std::set<int> durs;
+    };
+    const auto expect = [&](bool ci) {
+        std::map<std::string, want> ret;
+        for (int i = 0; i < 1000; ++i) {
+            std::string k = spellings[i % 4];
+            if (ci) k = my::utils::strings::to_lower(k);
+            auto& w = ret[k];
+            const double secs = (i % 10) * 60.0;
+            ++w.count;
+            w.sum += secs;
+            w.min = (std::min)(w.min, secs);
+            w.max = (std::max)(w.max, secs);
+            w.durs.insert(i % 10);
+        }
+        return ret;
+    };
+    const auto check = [&](std::vector<group> got, bool ci) {
+        const auto wanted = expect(ci);
+        assert(got.size() == wanted.size());
+        for (const auto& g : got) {
+            std::string k(g.key);
+            if (ci) k = my::utils::strings::to_lower(k);
+            const auto& w = wanted.at(k);
+            assert(g.values.count == w.count && g.values.sum == w.sum);
+            assert(g.values.min == w.min && g.values.max == w.max);
+            assert(g.distinct == w.durs.size());
+        }
+    };
+
+    for (const size_t threads : {size_t{1}, size_t{4}}) {
+        options opt;
+        opt.threads = threads;
+        opt.min_rows_per_thread = 1;
+        opt.count_distinct = true;
+        for (const bool ci : {true, false}) {
+            opt.case_insensitive = ci;
+            const auto* title = rd.column("title");
+            check(group_by_hash(artist, dur, opt), ci);
+            check(group_by_sort(artist, dur, opt), ci);
+            const auto sorted = group_by_sort(artist, dur, opt);
+            for (size_t i = 1; i < sorted.size(); ++i) {
+                assert(ci ? my::utils::strings::compare_less_nocase(
+                           sorted[i - 1].key, sorted[i].key)
+                          : sorted[i - 1].key < sorted[i].key);
+            }
+
+            // distinct follows opt, not the value column's dictionary
+            column_t codes = *title;
+            codes.typed.type = reader::column_type::dictionary;
+            codes.typed.dict = reader::unique_column_codes(codes, !ci);
+            const auto t = totals(codes, opt);
+            assert(t.values.count == 1000 && t.distinct == (ci ? 3U : 6U));
+        }
+
+        // a dictionary key groups the way its dictionary does
+        column_t dict_key = artist;
+        dict_key.typed.type = reader::column_type::dictionary;
+        dict_key.typed.dict = reader::unique_column_codes(dict_key, true);
+        opt.case_insensitive = true;
+        check(group_by_hash(dict_key, dur, opt), true);
+        check(group_by_sort(dict_key, dur, opt), true);
+
+        // only the selected rows
+        const auto sel = my::query::equals(artist, "queen");
+        opt.where = &sel;
+        const auto q = group_by_hash(artist, dur, opt);
+        assert(q.size() == 1 && q[0].key == "queen" && q[0].values.count == 250);
+        const auto t = totals(*dur, opt);
+        assert(t.values.count == 250);
+        opt.where = nullptr;
+        const auto all = totals(*dur, opt);
+        assert(all.values.count == 1000 && all.values.sum == 270000.0);
+        assert(all.values.mean() == 270.0);
+    }
+
+    // an exception on any worker comes back to the caller, after the join
+    for (const size_t bad : {size_t{0}, size_t{3}}) {
+        std::atomic<size_t> ran{0};
+        bool caught = false;
+        try {
+            detail::for_each_range(400, 4, [&](size_t t, size_t, size_t) {
+                ++ran;
+                if (t == bad) throw std::runtime_error("worker failed");
+            });
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        assert(caught && ran == 4);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main() {
+    try {
+        if (test_stream_reader()) {
+            throw std::runtime_error("test_stream_reader() failed.");
+        }
+        if (test_materialise()) {
+            throw std::runtime_error("test_materialise() failed.");
+        }
+        if (test_dictionary()) {
+            throw std::runtime_error("test_dictionary() failed.");
+        }
+        if (test_column_index()) {
+            throw std::runtime_error("test_column_index() failed.");
+        }
+        if (test_export()) {
+            throw std::runtime_error("test_export() failed.");
+        }
+        if (test_cache()) {
+            throw std::runtime_error("test_cache() failed.");
+        }
+        if (test_refresh()) {
+            throw std::runtime_error("test_refresh() failed.");
+        }
+        if (test_query()) {
+            throw std::runtime_error("test_query() failed.");
+        }
+        if (test_group_by()) {
+            throw std::runtime_error("test_group_by() failed.");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+    puts("All delim tests completed successfully.\n");
+    return 0;
+}
@@ -0,0 +1,644 @@
+// Tests for the sqlite wrapper and what is built on it.
+#ifdef NDEBUG
+#undef NDEBUG // asserts are the tests, so keep them in any build
+#endif
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <future>
+#include <mutex>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../sqlite.hpp"
+#include "../sqlite_import.hpp"
+
+namespace {
+
+std::string temp_db(const char* name) {
+    const auto path = (std::filesystem::temp_directory_path() / name).string();
+    std::remove(path.c_str());
+    std::remove((path + "-journal").c_str());
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+    return path;
+}
+
+int test_transaction() {
+    sqlite db(":memory:");
+    db.errors_to_stderr(false);
+    assert(db.exec("CREATE TABLE t (ID INTEGER PRIMARY KEY, name TEXT, "
+                   "dur REAL, n INTEGER NOT NULL)")
+        == SQLITE_OK);
+
+    // batch_insert: one statement, one transaction
+    std::vector<std::string> names;
+    for (int i = 0; i < 1000; ++i) {
+        names.push_back("name'\"" + std::to_string(i));
+    }
+    size_t i = 0;
+    size_t inserted = 0;
+    int rc = db.batch_insert(
+        "t", {"name", "dur", "n"},
+        [&](sqlite::statement& st) {
+            if (i == names.size()) return false;
+            st.bind_static(1, names[i]);
+            st.bind(2, static_cast<double>(i) * 0.5);
+            st.bind(3, i);
+            ++i;
+            return true;
+        },
+        &inserted);
+    assert(rc == SQLITE_OK && inserted == 1000);
+    assert(db.row_count("t") == 1000);
+
+    // a failing row rolls back the whole batch
+    i = 0;
+    rc = db.batch_insert("t", {"name", "n"}, [&](sqlite::statement& st) {
+        st.bind(1, "x");
+        if (i == 5) {
+            st.bind(2, nullptr);
+        } else {
+            st.bind(2, i);
+        }
+        return i++ < 10;
+    });
+    assert(rc == SQLITE_CONSTRAINT && !db.last_error_string().empty());
+    assert(db.row_count("t") == 1000);
+
+    auto st = db.prepare("SELECT COUNT(*) FROM t WHERE n >= ? AND name <> ?");
+    assert(st && st.bind_all(500, std::string("x")) == SQLITE_OK);
+    assert(st.step() == SQLITE_ROW && sqlite3_column_int(st.handle(), 0) == 500);
+    st.finalize();
+    assert(!db.prepare("SELEC nonsense"));
+    assert(sqlite::quote_identifier("a\"b") == "\"a\"\"b\"");
+
+    // rolled back unless committed
+    {
+        sqlite::transaction tx(db);
+        assert(tx.active());
+        db.exec("DELETE FROM t");
+    }
+    assert(db.row_count("t") == 1000);
+    {
+        sqlite::transaction tx(db);
+        db.exec("DELETE FROM t WHERE n < 10");
+        assert(tx.rollback() == SQLITE_OK && !tx.active());
+        assert(tx.rollback() == SQLITE_MISUSE);
+    }
+    assert(db.row_count("t") == 1000);
+    {
+        sqlite::transaction tx(db);
+        db.exec("DELETE FROM t WHERE n < 10");
+        assert(tx.commit() == SQLITE_OK && !tx.active());
+        assert(tx.commit() == SQLITE_MISUSE);
+    }
+    assert(db.row_count("t") == 990);
+    return 0;
+}
+
+int test_busy_commit() {
+    // another connection reading keeps us from committing (no WAL)
+    const auto path = temp_db("test-sqlite-busy.db");
+    sqlite writer(path);
+    sqlite reader(path);
+    writer.errors_to_stderr(false);
+    assert(writer.exec("CREATE TABLE t (x INTEGER)") == SQLITE_OK);
+    assert(writer.exec("INSERT INTO t VALUES (1)") == SQLITE_OK);
+
+    auto rd = reader.prepare("SELECT x FROM t");
+    assert(rd.step() == SQLITE_ROW); // holds a shared lock until reset
+    {
+        sqlite::transaction tx(writer);
+        assert(writer.exec("INSERT INTO t VALUES (2)") == SQLITE_OK);
+        assert(tx.commit() == SQLITE_BUSY);
+        assert(tx.active()); // still ours, to retry or roll back
+        rd.reset();
+        assert(tx.commit() == SQLITE_OK && !tx.active());
+    }
+    assert(reader.row_count("t") == 2);
+
+    // and if we give up, it rolls back
+    assert(rd.step() == SQLITE_ROW);
+    {
+        sqlite::transaction tx(writer);
+        assert(writer.exec("INSERT INTO t VALUES (3)") == SQLITE_OK);
+        assert(tx.commit() == SQLITE_BUSY && tx.active());
+    }
+    rd.reset();
+    assert(reader.row_count("t") == 2);
+    sqlite::transaction again(writer); // not stuck in the old one
+    assert(again.active());
+    return 0;
+}
+
+int test_cursor() {
+    sqlite db(":memory:");
+    db.errors_to_stderr(false);
+    db.exec("CREATE TABLE t (name TEXT, dur REAL, n INTEGER, b BLOB)");
+    size_t i = 0;
+    const int rc = db.batch_insert(
+        "t", {"name", "dur", "n", "b"}, [&](sqlite::statement& st) {
+            if (i == 1000) return false;
+            st.bind(1, "nm" + std::to_string(i));
+            st.bind(2, static_cast<double>(i) * 0.5);
+            if (i % 10) {
+                st.bind(3, i);
+            } else {
+                st.bind(3, nullptr);
+            }
+            st.bind_blob(4, "a\0b", 3);
+            ++i;
+            return true;
+        });
+    assert(rc == SQLITE_OK);
+
+    auto c = db.query("SELECT name, dur, n, b FROM t WHERE n >= ?", 500);
+    assert(c.column_count() == 4 && c.column_name(0) == "name");
+    assert(c.column_index("DUR") == 1 && c.column_index("zz") == -1);
+    double total = 0;
+    size_t rows = 0;
+    while (c.next()) {
+        assert(c.text(0).substr(0, 2) == "nm");
+        assert(c.get<int>(2) >= 500 && c.type(1) == SQLITE_FLOAT);
+        assert(c.blob(3).size() == 3);
+        total += c.real(1);
+        ++rows;
+    }
+    assert(c.status() == SQLITE_DONE && c.ok() && rows == 450);
+    double want = 0;
+    for (size_t n = 500; n < 1000; ++n) {
+        want += n % 10 ? static_cast<double>(n) * 0.5 : 0;
+    }
+    assert(total == want);
+    assert(!c.next());
+
+    int nulls = 0;
+    assert(db.for_each_row("SELECT n FROM t",
+               [&](const sqlite::cursor& row) {
+                   nulls += row.is_null(0) ? 1 : 0;
+                   return 0;
+               })
+        == SQLITE_OK);
+    assert(nulls == 100);
+    int seen = 0; // a non-zero return stops the walk, and is returned
+    assert(db.for_each_row("SELECT n FROM t",
+               [&](const sqlite::cursor&) { return ++seen == 5 ? -7 : 0; })
+        == -7);
+    assert(seen == 5);
+
+    auto bad = db.query("SELECT nope FROM t");
+    assert(!bad.next() && !bad.ok() && !db.last_error_string().empty());
+
+    // over a statement we keep: reset each time the cursor goes
+    auto st = db.prepare("SELECT COUNT(*) FROM t");
+    for (int k = 0; k < 2; ++k) {
+        sqlite::cursor cc(db, st);
+        assert(cc.next() && cc.get<int64_t>(0) == 1000 && !cc.next());
+    }
+    auto moved = db.query("SELECT name FROM t ORDER BY rowid");
+    assert(moved.next());
+    auto other = std::move(moved);
+    assert(other.next() && other.text(0) == "nm1" && !moved.next());
+    return 0;
+}
+
+int test_select_into() {
+    sqlite db(":memory:");
+    db.errors_to_stderr(false);
+    db.exec("CREATE TABLE t (ID INTEGER PRIMARY KEY, name TEXT, dur, "
+            "n INTEGER, b BLOB)");
+    size_t i = 0;
+    const int rc = db.batch_insert(
+        "t", {"ID", "name", "dur", "n", "b"}, [&](sqlite::statement& st) {
+            if (i == 1000) return false;
+            st.bind(1, 5000 + i);
+            if (i < 3) {
+                st.bind(2, nullptr);
+            } else {
+                st.bind(2, "nm" + std::to_string(i));
+            }
+            if (i < 10) {
+                st.bind(3, static_cast<int>(i)); // then floats: promoted
+            } else {
+                st.bind(3, static_cast<double>(i) * 0.5);
+            }
+            if (i % 10) {
+                st.bind(4, i);
+            } else {
+                st.bind(4, nullptr);
+            }
+            st.bind_blob(5, "a\0b", 3);
+            ++i;
+            return true;
+        });
+    assert(rc == SQLITE_OK);
+
+    sqlite::result_set rs;
+    sqlite::select_options opts;
+    opts.count_first = true;
+    opts.key_column = "id";
+    assert(db.select_into(rs, "SELECT * FROM t WHERE ID >= ?", opts, 5000)
+        == SQLITE_OK);
+    assert(rs.rows == 1000 && rs.columns.size() == 5);
+    const auto* name = rs.find("NAME");
+    assert(name && name->type == SQLITE_TEXT && name->is_null(0));
+    assert(name->text(0).empty() && name->text(3) == "nm3");
+    assert(name->text(999) == "nm999");
+    const auto* dur = rs.find("dur");
+    assert(dur->type == SQLITE_FLOAT && dur->real(5) == 5);
+    assert(dur->real(20) == 10 && dur->int64(21) == 10);
+    const auto* n = rs.find("n");
+    assert(n->type == SQLITE_INTEGER && n->is_null(0) && n->is_null(990));
+    assert(n->int64(11) == 11 && n->real(11) == 11.0);
+    const auto* b = rs.find("b");
+    assert(b->type == SQLITE_BLOB && b->text(7) == std::string_view("a\0b", 3));
+    assert(rs.find("nope") == nullptr);
+    assert(rs.row_of(5123) == 123 && rs.row_of(1) == rs.npos);
+
+    // text keys are keyed by their text; NULL keys are left out
+    opts.key_column = "name";
+    assert(db.select_into(rs, "SELECT * FROM t", opts) == SQLITE_OK);
+    assert(rs.row_of("nm123") == 123 && rs.row_of("nm1") == rs.npos);
+    assert(rs.text_index.size() == 997 && rs.row_index.empty());
+    assert(rs.row_of(int64_t{0}) == rs.npos);
+
+    // a key column that isn't there is an error, not silently no index
+    opts.key_column = "nope";
+    assert(db.select_into(rs, "SELECT * FROM t", opts) == SQLITE_ERROR);
+    assert(db.last_error_string().find("nope") != std::string_view::npos);
+
+    sqlite::result_set r2;
+    assert(db.select_into(r2, "SELECT NULL AS x, 1 AS y") == SQLITE_OK);
+    assert(r2.rows == 1 && r2.columns[0].is_null(0));
+    assert(db.select_into(r2, "SELECT * FROM nope") != SQLITE_OK);
+    return 0;
+}
+
+int test_pool() {
+    const auto path = temp_db("test-sqlite-pool.db");
+    {
+        // each connection has its own last error
+        sqlite a(path);
+        sqlite b(path);
+        a.errors_to_stderr(false);
+        assert(a.exec("SELECT * FROM nope") != SQLITE_OK);
+        assert(b.exec("CREATE TABLE t (n INTEGER)") == SQLITE_OK);
+        assert(a.last_error_string().find("nope") != std::string_view::npos);
+        assert(b.last_error_string().empty());
+        bool threw = false;
+        try {
+            sqlite c("/nonexistent/dir/x.db", SQLITE_OPEN_READONLY);
+        } catch (const std::exception&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    // a lease is the taking thread's, so it can't be handed on
+    static_assert(!std::is_move_constructible_v<sqlite_pool::lease>);
+    static_assert(!std::is_move_assignable_v<sqlite_pool::lease>);
+
+    sqlite_pool pool(path, 4);
+    assert(pool.reader_count() == 4);
+    {
+        auto w = pool.writer();
+        size_t i = 0;
+        assert(w->batch_insert("t", {"n"},
+                   [&](sqlite::statement& st) {
+                       st.bind(1, i);
+                       return i++ < 10000;
+                   })
+            == SQLITE_OK);
+        auto again = pool.writer(); // same thread: same connection
+        assert(&*again == &*w);
+    }
+
+    std::vector<std::thread> threads;
+    std::atomic<int64_t> total{0};
+    std::atomic<int> shared{0};
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&] {
+            for (int k = 0; k < 20; ++k) {
+                auto r = pool.reader();
+                auto r2 = pool.reader();
+                if (&*r != &*r2) ++shared;
+                auto c = r->query("SELECT SUM(n) FROM t");
+                if (c.next()) total += c.int64(0);
+                if (k % 5 == 0) {
+                    auto w = pool.writer();
+                    w->exec("INSERT INTO t VALUES (0)");
+                }
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    assert(shared == 0);
+    assert(total == int64_t{8 * 20} * (9999LL * 10000 / 2));
+    assert(pool.writer()->row_count("t") == 10000 + 8 * 4);
+
+    auto r = pool.reader(); // read-only
+    r->errors_to_stderr(false);
+    assert(r->exec("INSERT INTO t VALUES (1)") != SQLITE_OK);
+    r.release();
+    assert(!r);
+    return 0;
+}
+
+int test_statement_cache() {
+    sqlite db(":memory:");
+    db.errors_to_stderr(false);
+    db.exec("CREATE TABLE t (ID INTEGER PRIMARY KEY, name TEXT)");
+    size_t i = 0;
+    assert(db.batch_insert("t", {"ID", "name"},
+               [&](sqlite::statement& st) {
+                   st.bind(1, i);
+                   st.bind(2, "n" + std::to_string(i));
+                   return ++i <= 100;
+               })
+        == SQLITE_OK);
+    db.clear_statement_cache();
+    const auto before = db.statement_cache_info();
+    for (int k = 0; k < 100; ++k) {
+        assert(db.row_count("t") == 100);
+    }
+    auto s = db.statement_cache_info();
+    assert(s.hits - before.hits == 99 && s.misses - before.misses == 1);
+    assert(s.size == 1 && s.capacity == 32);
+
+    const char* sql = "SELECT name FROM t WHERE ID = ?";
+    for (int k = 0; k < 10; ++k) {
+        auto st = db.cached(sql);
+        st->bind(1, k);
+        sqlite::cursor c(db, *st);
+        assert(c.next() && c.text(0) == "n" + std::to_string(k));
+        if (k == 5) { // the same sql in use twice at once
+            auto st2 = db.cached(sql);
+            assert(st2 && &*st2 != &*st);
+            st2->bind(1, 1);
+            sqlite::cursor c2(db, *st2);
+            assert(c2.next() && c2.text(0) == "n1");
+        }
+    }
+    // returned with bindings cleared
+    {
+        auto st = db.cached(sql);
+        sqlite::cursor c(db, *st);
+        assert(!c.next() && c.status() == SQLITE_DONE);
+    }
+    assert(db.statement_cache_info().size == 2);
+
+    // least recently used goes first
+    db.clear_statement_cache();
+    db.set_statement_cache_size(3);
+    const auto misses = [&] { return db.statement_cache_info().misses; };
+    const auto use = [&](const char* q) {
+        auto st = db.cached(q);
+        assert(st && st->step() == SQLITE_ROW);
+    };
+    const auto m0 = misses();
+    use("SELECT 1");
+    use("SELECT 2");
+    use("SELECT 3");
+    use("SELECT 1"); // a hit, and now the most recent
+    assert(misses() - m0 == 3);
+    use("SELECT 4"); // evicts 2, the least recently used
+    assert(db.statement_cache_info().size == 3);
+    use("SELECT 1");
+    use("SELECT 3");
+    assert(misses() - m0 == 4);
+    use("SELECT 2");
+    assert(misses() - m0 == 5);
+
+    db.set_statement_cache_size(1);
+    assert(db.statement_cache_info().size == 1);
+    assert(!db.cached("SELECT nope"));
+    assert(db.statement_cache_info().size == 1);
+    db.set_statement_cache_size(0);
+    for (int k = 0; k < 3; ++k) {
+        db.row_count("t");
+    }
+    assert(db.statement_cache_info().size == 0);
+    return 0;
+}
+
+int test_async() {
+    const auto path = temp_db("test-sqlite-async.db");
+    {
+        sqlite_async db(path);
+        auto created = db.submit([](sqlite& s) {
+            s.errors_to_stderr(false);
+            return s.exec("CREATE TABLE t (n INTEGER NOT NULL)");
+        });
+        assert(created.get() == SQLITE_OK);
+
+        std::vector<std::future<int>> done;
+        std::vector<std::thread> threads;
+        std::mutex m;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                for (int k = 0; k < 250; ++k) {
+                    auto f = db.write(
+                        "INSERT INTO t VALUES (" + std::to_string(k) + ")");
+                    std::lock_guard<std::mutex> lock(m);
+                    done.push_back(std::move(f));
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        auto bad = db.write("INSERT INTO t VALUES (NULL)");
+        auto threw = db.write([](sqlite&) -> int {
+            throw std::runtime_error("boom");
+        });
+        // writes may use sqlite::transaction, through batch_insert() here
+        auto batch = db.write([](sqlite& s) {
+            int i = 0;
+            return s.batch_insert("t", {"n"}, [&](sqlite::statement& st) {
+                st.bind(1, i);
+                return i++ < 100;
+            });
+        });
+        // and one that fails is undone, whatever the others do
+        auto half = db.write([](sqlite& s) {
+            int i = 0;
+            return s.batch_insert("t", {"n"}, [&](sqlite::statement& st) {
+                if (i == 50) {
+                    st.bind(1, nullptr);
+                } else {
+                    st.bind(1, i);
+                }
+                return i++ < 100;
+            });
+        });
+        auto raw_begin = db.write("BEGIN");
+
+        for (auto& f : done) {
+            assert(f.get() == SQLITE_OK);
+        }
+        assert(bad.get() == SQLITE_CONSTRAINT);
+        bool caught = false;
+        try {
+            threw.get();
+        } catch (const std::runtime_error& e) {
+            caught = std::string(e.what()) == "boom";
+        }
+        assert(caught);
+        assert(batch.get() == SQLITE_OK);
+        assert(half.get() == SQLITE_CONSTRAINT);
+        assert(raw_begin.get() != SQLITE_OK);
+        assert(db.group_commits() >= 1 && db.group_commits() < 1000);
+
+        auto n = db.submit([](sqlite& s) { return s.row_count("t"); });
+        assert(n.get() == 1100);
+        auto oops = db.submit([](sqlite&) -> int { throw std::logic_error("x"); });
+        caught = false;
+        try {
+            oops.get();
+        } catch (const std::logic_error&) {
+            caught = true;
+        }
+        assert(caught);
+        for (int k = 0; k < 100; ++k) {
+            db.write("INSERT INTO t VALUES (1)"); // finished by the destructor
+        }
+    }
+    sqlite s(path);
+    assert(s.row_count("t") == 1200);
+
+    // a transaction inside a transaction is a savepoint
+    {
+        sqlite::transaction outer(s);
+        assert(outer.active() && !outer.nested());
+        {
+            sqlite::transaction inner(s);
+            assert(inner.active() && inner.nested());
+            s.exec("DELETE FROM t");
+        }
+        assert(s.row_count("t") == 1200);
+        {
+            sqlite::transaction inner(s);
+            s.exec("DELETE FROM t WHERE rowid > 1100");
+            assert(inner.commit() == SQLITE_OK && !inner.active());
+        }
+        assert(s.row_count("t") == 1100);
+    }
+    assert(s.row_count("t") == 1200);
+    return 0;
+}
+
+int test_import() {
+    const auto tsv
+        = (std::filesystem::temp_directory_path() / "test-sqlite-import.tsv")
+              .string();
+    {
+        std::ofstream f(tsv, std::ios::binary | std::ios::trunc);
+        f << "Id\tArtist\tDur\tScore\tNote\n";
+        for (int i = 0; i < 1000; ++i) {
+            f << i << "\tArt\"ist " << i % 97 << "\t" << i % 10 << ":0"
+              << i % 6 << "\t";
+            if (i % 7) f << i * 0.25; // else no score
+            f << "\t" << (i % 3 ? "x" : "") << "\n";
+        }
+    }
+    my::DelimitedTextReader rd(tsv);
+    rd.materialise_all();
+
+    sqlite db(":memory:");
+    db.errors_to_stderr(false);
+    my::sqlite_import_options opts;
+    opts.indexes = {"Artist"};
+    opts.batch_size = 300;
+    size_t n = 0;
+    assert(my::sqlite_import(db, rd, "tracks", opts, &n) == SQLITE_OK);
+    assert(n == 1000 && db.row_count("tracks") == 1000);
+
+    // every value back as it went in
+    sqlite::result_set rs;
+    sqlite::select_options sel;
+    sel.key_column = "Id";
+    assert(db.select_into(rs, "SELECT * FROM tracks", sel) == SQLITE_OK);
+    const auto* id = rs.find("Id");
+    const auto* artist = rs.find("Artist");
+    const auto* dur = rs.find("Dur");
+    const auto* score = rs.find("Score");
+    const auto* note = rs.find("Note");
+    assert(id->type == SQLITE_INTEGER && score->type == SQLITE_FLOAT);
+    assert(dur->type == SQLITE_TEXT && note->type == SQLITE_TEXT);
+    for (size_t i = 0; i < 1000; ++i) {
+        const size_t row = rs.row_of(static_cast<int64_t>(i));
+        assert(row != rs.npos);
+        assert(artist->text(row) == rd.column("artist")->values[i]);
+        assert(dur->text(row) == rd.column("dur")->values[i]);
+        // an empty number is NULL, not 0
+        assert(score->is_null(row) == (i % 7 == 0));
+        if (i % 7) assert(score->real(row) == static_cast<double>(i) * 0.25);
+        assert(!note->is_null(row) && note->text(row) == (i % 3 ? "x" : ""));
+    }
+    {
+        auto ix
+            = db.query("SELECT name FROM sqlite_master WHERE type = 'index'");
+        assert(ix.next() && ix.text(0) == "tracks_Artist");
+    }
+
+    // empty_as_null: text too
+    opts.empty_as_null = true;
+    opts.replace_table = true;
+    opts.indexes.clear();
+    assert(my::sqlite_import(db, rd, "tracks", opts, &n) == SQLITE_OK);
+    auto c = db.query("SELECT COUNT(*) FROM tracks WHERE Note IS NULL");
+    assert(c.next() && c.int64(0) == 334);
+
+    // a failing batch is rolled back; the ones before it stay
+    db.exec("CREATE TABLE u (Id INTEGER, Artist TEXT UNIQUE, Dur TEXT, "
+            "Score REAL, Note TEXT)");
+    opts.replace_table = false;
+    opts.batch_size = 50;
+    assert(my::sqlite_import(db, rd, "u", opts, &n) == SQLITE_CONSTRAINT);
+    assert(n == 50 && db.row_count("u") == 50);
+    return 0;
+}
+
+} // namespace
+
+int main() {
+    try {
+        if (test_transaction()) {
+            throw std::runtime_error("test_transaction() failed.");
+        }
+        if (test_busy_commit()) {
+            throw std::runtime_error("test_busy_commit() failed.");
+        }
+        if (test_cursor()) {
+            throw std::runtime_error("test_cursor() failed.");
+        }
+        if (test_select_into()) {
+            throw std::runtime_error("test_select_into() failed.");
+        }
+        if (test_pool()) {
+            throw std::runtime_error("test_pool() failed.");
+        }
+        if (test_statement_cache()) {
+            throw std::runtime_error("test_statement_cache() failed.");
+        }
+        if (test_async()) {
+            throw std::runtime_error("test_async() failed.");
+        }
+        if (test_import()) {
+            throw std::runtime_error("test_import() failed.");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+    puts("All sqlite tests completed successfully.\n");
+    return 0;
+}